@@ -17,6 +17,40 @@
 #include <variant>
 #include <iomanip>
 #include <optional>
+#include <utility>
+#include <tuple>
+#include <string_view>
+#include <cstdint>
+#include <bit>
+#include <span>
+#include <array>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <charconv>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#include <unistd.h>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 using namespace std::chrono;
@@ -31,76 +65,811 @@ using namespace std::chrono;
 #define CYAN    "\033[36m"
 #define BOLD    "\033[1m"
 
+// --------------------------
+// Id Index (open addressing)
+// --------------------------
+
+// Maps an entity id to its slot in the owning vector. Keys are views into the
+// entity's own id string, so the entity must outlive its entry.
+class IdIndex {
+    static constexpr size_t EMPTY = SIZE_MAX;
+
+    struct Entry {
+        string_view key;
+        size_t slot = EMPTY;
+    };
+
+    vector<Entry> table;
+    size_t count = 0;
+
+    static size_t hashKey(string_view key) {
+        // FNV-1a, good enough for short ids like "S001" / "CS101"
+        size_t h = 1469598103934665603ULL;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    void grow() {
+        vector<Entry> old = move(table);
+        table.assign(old.empty() ? 16 : old.size() * 2, Entry{});
+        count = 0;
+        for (const auto& e : old) {
+            if (e.slot != EMPTY) insert(e.key, e.slot);
+        }
+    }
+
+public:
+    // Returns false if the key is already present (existing slot is kept)
+    bool insert(string_view key, size_t slot) {
+        if ((count + 1) * 4 > table.size() * 3) grow();
+        size_t mask = table.size() - 1;
+        for (size_t i = hashKey(key) & mask;; i = (i + 1) & mask) {
+            if (table[i].slot == EMPTY) {
+                table[i] = {key, slot};
+                count++;
+                return true;
+            }
+            if (table[i].key == key) return false;
+        }
+    }
+
+    optional<size_t> find(string_view key) const {
+        if (table.empty()) return nullopt;
+        size_t mask = table.size() - 1;
+        for (size_t i = hashKey(key) & mask;; i = (i + 1) & mask) {
+            if (table[i].slot == EMPTY) return nullopt;
+            if (table[i].key == key) return table[i].slot;
+        }
+    }
+
+    void reserve(size_t n) {
+        while (n * 4 > table.size() * 3) grow();
+    }
+
+    size_t size() const { return count; }
+};
+
+// --------------------------
+// Symbol Table (id interning)
+// --------------------------
+
+// Dense handle for an interned external id ("S001", "CS101", ...)
+using SymbolId = uint32_t;
+
+// Process-wide intern table. Names live in a deque so references and views
+// handed out stay valid as the table grows.
+class SymbolTable {
+    deque<string> names;
+    IdIndex index;
+    mutable shared_mutex mtx;
+
+public:
+    SymbolId intern(string_view name) {
+        {
+            shared_lock<shared_mutex> lock(mtx);
+            if (auto slot = index.find(name)) return static_cast<SymbolId>(*slot);
+        }
+        unique_lock<shared_mutex> lock(mtx);
+        if (auto slot = index.find(name)) return static_cast<SymbolId>(*slot);
+        if (names.size() >= UINT32_MAX) throw runtime_error("Symbol table full");
+        SymbolId handle = names.size();
+        names.emplace_back(name);
+        index.insert(names.back(), handle);
+        return handle;
+    }
+
+    optional<SymbolId> lookup(string_view name) const {
+        shared_lock<shared_mutex> lock(mtx);
+        auto slot = index.find(name);
+        return slot ? optional<SymbolId>(static_cast<SymbolId>(*slot)) : nullopt;
+    }
+
+    const string& name(SymbolId handle) const {
+        shared_lock<shared_mutex> lock(mtx);
+        return names.at(handle);
+    }
+
+    size_t size() const {
+        shared_lock<shared_mutex> lock(mtx);
+        return names.size();
+    }
+};
+
+SymbolTable& symbols() {
+    static SymbolTable table;
+    return table;
+}
+
+// Fixed pool of mutexes shared by many objects, picked by key hash. Used for
+// per-student locking without a mutex inside every Student.
+template <size_t N>
+class LockStripes {
+    static_assert((N & (N - 1)) == 0, "stripe count must be a power of two");
+    struct alignas(64) Stripe { mutex mtx; };
+    array<Stripe, N> stripes;
+
+public:
+    mutex& forKey(uint32_t key) {
+        return stripes[(key * 2654435761u) & (N - 1)].mtx;
+    }
+};
+
+LockStripes<256>& studentLocks() {
+    static LockStripes<256> locks;
+    return locks;
+}
+
+// Sorted vector of handles, used in place of set<string> for memberships
+class HandleSet {
+    vector<SymbolId> items;
+
+public:
+    bool insert(SymbolId handle) {
+        auto it = lower_bound(items.begin(), items.end(), handle);
+        if (it != items.end() && *it == handle) return false;
+        items.insert(it, handle);
+        return true;
+    }
+
+    bool erase(SymbolId handle) {
+        auto it = lower_bound(items.begin(), items.end(), handle);
+        if (it == items.end() || *it != handle) return false;
+        items.erase(it);
+        return true;
+    }
+
+    bool contains(SymbolId handle) const {
+        return binary_search(items.begin(), items.end(), handle);
+    }
+
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    vector<SymbolId>::const_iterator begin() const { return items.begin(); }
+    vector<SymbolId>::const_iterator end() const { return items.end(); }
+};
+
+// --------------------------
+// Metrics
+// --------------------------
+
+// Per-thread counters and log-linear latency histograms. Each thread owns a
+// block it alone writes with relaxed load+store (no locked instructions);
+// snapshots sum every block. Blocks of exited threads are kept for reuse, so
+// totals only ever grow. Build with -DCOLLEGE_METRICS=0 to compile every
+// timer away.
+#ifndef COLLEGE_METRICS
+#define COLLEGE_METRICS 1
+#endif
+
+enum class Metric : uint8_t {
+    ENROLL, WAM_UPDATE, OBSERVER_DISPATCH, FILE_PARSE, REPORT_GENERATION, LOG_SYNC, REQUEST_BATCH, COUNT
+};
+enum class Counter : uint8_t {
+    ENROLL_REJECTED, ROWS_PARSED, PARSE_ERRORS, EVENTS_COALESCED, REPORTS_WRITTEN, LOG_RECORDS, LOG_SYNCS,
+    REQUESTS, COUNT
+};
+
+constexpr const char* metricName(Metric metric) {
+    switch (metric) {
+        case Metric::ENROLL: return "enroll";
+        case Metric::WAM_UPDATE: return "wam_update";
+        case Metric::OBSERVER_DISPATCH: return "observer_dispatch";
+        case Metric::FILE_PARSE: return "file_parse";
+        case Metric::REPORT_GENERATION: return "report_generation";
+        case Metric::LOG_SYNC: return "log_sync";
+        case Metric::REQUEST_BATCH: return "request_batch";
+        default: return "unknown";
+    }
+}
+
+constexpr const char* counterName(Counter counter) {
+    switch (counter) {
+        case Counter::ENROLL_REJECTED: return "enroll_rejected";
+        case Counter::ROWS_PARSED: return "rows_parsed";
+        case Counter::PARSE_ERRORS: return "parse_errors";
+        case Counter::EVENTS_COALESCED: return "events_coalesced";
+        case Counter::REPORTS_WRITTEN: return "reports_written";
+        case Counter::LOG_RECORDS: return "log_records";
+        case Counter::LOG_SYNCS: return "log_syncs";
+        case Counter::REQUESTS: return "requests";
+        default: return "unknown";
+    }
+}
+
+constexpr size_t METRIC_COUNT = static_cast<size_t>(Metric::COUNT);
+constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::COUNT);
+
+// HDR-style buckets: exact below 16ns, then 16 sub-buckets per power of two
+// (worst-case relative error 1/16)
+struct LatencyBuckets {
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr unsigned SUB = 1u << SUB_BITS;
+    static constexpr size_t SIZE = (64 - SUB_BITS + 1) * SUB;
+
+    static size_t index(uint64_t ns) {
+        if (ns < SUB) return ns;
+        unsigned msb = 63 - __builtin_clzll(ns);
+        unsigned shift = msb - SUB_BITS;
+        return (shift + 1) * SUB + ((ns >> shift) & (SUB - 1));
+    }
+
+    // Largest value that maps to bucket i
+    static uint64_t upperBound(size_t i) {
+        if (i < SUB) return i;
+        unsigned shift = i / SUB - 1;
+        uint64_t base = (uint64_t(SUB) | (i % SUB)) << shift;
+        return base + ((uint64_t(1) << shift) - 1);
+    }
+};
+
+struct MetricSummary {
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+    vector<uint64_t> buckets = vector<uint64_t>(LatencyBuckets::SIZE);
+
+    uint64_t percentile(double q) const {
+        if (count == 0) return 0;
+        uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(ceil(q * count)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < buckets.size(); ++i) {
+            seen += buckets[i];
+            if (seen >= rank) return min(LatencyBuckets::upperBound(i), max_ns);
+        }
+        return max_ns;
+    }
+};
+
+struct MetricsSnapshot {
+    array<MetricSummary, METRIC_COUNT> metrics;
+    array<uint64_t, COUNTER_COUNT> counters{};
+
+    const MetricSummary& operator[](Metric metric) const { return metrics[static_cast<size_t>(metric)]; }
+    uint64_t operator[](Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+
+    string toPrometheus() const;
+    string toJson() const;
+};
+
+class MetricsRegistry {
+    struct Histogram {
+        atomic<uint64_t> count{0}, sum_ns{0}, max_ns{0};
+        array<atomic<uint64_t>, LatencyBuckets::SIZE> buckets{};
+    };
+
+    struct alignas(64) Block {
+        array<Histogram, METRIC_COUNT> histograms;
+        array<atomic<uint64_t>, COUNTER_COUNT> counters{};
+    };
+
+    // Single-writer increment: only the owning thread stores to its block
+    static void bump(atomic<uint64_t>& value, uint64_t by) {
+        value.store(value.load(memory_order_relaxed) + by, memory_order_relaxed);
+    }
+
+    mutable mutex mtx; // guards the block lists, taken once per thread
+    vector<unique_ptr<Block>> blocks;
+    vector<Block*> free_blocks;
+
+    struct Lease {
+        Block* block = nullptr;
+        ~Lease() {
+            if (block) instance().release(block);
+        }
+    };
+
+    Block* acquire() {
+        lock_guard<mutex> lock(mtx);
+        if (!free_blocks.empty()) {
+            Block* block = free_blocks.back();
+            free_blocks.pop_back();
+            return block;
+        }
+        blocks.push_back(make_unique<Block>());
+        return blocks.back().get();
+    }
+
+    void release(Block* block) {
+        lock_guard<mutex> lock(mtx);
+        free_blocks.push_back(block);
+    }
+
+    Block& local() {
+        thread_local Lease lease;
+        if (!lease.block) lease.block = acquire();
+        return *lease.block;
+    }
+
+public:
+    static MetricsRegistry& instance() {
+        static MetricsRegistry* registry = new MetricsRegistry(); // outlives thread_local leases
+        return *registry;
+    }
+
+    void record(Metric metric, nanoseconds elapsed) {
+        uint64_t ns = elapsed.count() > 0 ? uint64_t(elapsed.count()) : 0;
+        Histogram& h = local().histograms[static_cast<size_t>(metric)];
+        bump(h.count, 1);
+        bump(h.sum_ns, ns);
+        if (ns > h.max_ns.load(memory_order_relaxed)) h.max_ns.store(ns, memory_order_relaxed);
+        bump(h.buckets[LatencyBuckets::index(ns)], 1);
+    }
+
+    void add(Counter counter, uint64_t by = 1) {
+        bump(local().counters[static_cast<size_t>(counter)], by);
+    }
+
+    MetricsSnapshot snapshot() const {
+        MetricsSnapshot result;
+        lock_guard<mutex> lock(mtx);
+        for (const auto& block : blocks) {
+            for (size_t m = 0; m < METRIC_COUNT; ++m) {
+                const Histogram& h = block->histograms[m];
+                MetricSummary& out = result.metrics[m];
+                out.count += h.count.load(memory_order_relaxed);
+                out.sum_ns += h.sum_ns.load(memory_order_relaxed);
+                out.max_ns = max(out.max_ns, h.max_ns.load(memory_order_relaxed));
+                for (size_t i = 0; i < LatencyBuckets::SIZE; ++i) out.buckets[i] += h.buckets[i].load(memory_order_relaxed);
+            }
+            for (size_t c = 0; c < COUNTER_COUNT; ++c) result.counters[c] += block->counters[c].load(memory_order_relaxed);
+        }
+        return result;
+    }
+};
+
+inline MetricsRegistry& metrics() { return MetricsRegistry::instance(); }
+
+#if COLLEGE_METRICS
+class ScopedTimer {
+    Metric metric;
+    steady_clock::time_point start = steady_clock::now();
+
+public:
+    explicit ScopedTimer(Metric metric) : metric(metric) {}
+    ~ScopedTimer() { metrics().record(metric, steady_clock::now() - start); }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+};
+
+inline void countMetric(Counter counter, uint64_t by = 1) { metrics().add(counter, by); }
+#else
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Metric) {}
+};
+
+inline void countMetric(Counter, uint64_t = 1) {}
+#endif
+
+#define COLLEGE_TIMER_CAT2(a, b) a##b
+#define COLLEGE_TIMER_CAT(a, b) COLLEGE_TIMER_CAT2(a, b)
+#define SCOPED_TIMER(metric) ScopedTimer COLLEGE_TIMER_CAT(scoped_timer_, __LINE__)(metric)
+
+string MetricsSnapshot::toPrometheus() const {
+    string out;
+    char buf[32];
+    auto num = [&](double value) {
+        auto [end, ec] = to_chars(buf, buf + sizeof(buf), value);
+        out.append(buf, ec == errc() ? end : buf);
+    };
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        const MetricSummary& s = metrics[m];
+        string name = string("college_") + metricName(static_cast<Metric>(m)) + "_seconds";
+        out += "# TYPE " + name + " summary\n";
+        for (double q : {0.5, 0.99, 0.999}) {
+            out += name + "{quantile=\"";
+            num(q);
+            out += "\"} ";
+            num(s.percentile(q) / 1e9);
+            out += '\n';
+        }
+        out += name + "_sum ";
+        num(s.sum_ns / 1e9);
+        out += '\n' + name + "_count " + to_string(s.count) + '\n';
+    }
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        string name = string("college_") + counterName(static_cast<Counter>(c)) + "_total";
+        out += "# TYPE " + name + " counter\n" + name + ' ' + to_string(counters[c]) + '\n';
+    }
+    return out;
+}
+
+string MetricsSnapshot::toJson() const {
+    string out = "{\"latency\":{";
+    for (size_t m = 0; m < METRIC_COUNT; ++m) {
+        const MetricSummary& s = metrics[m];
+        if (m) out += ',';
+        out += '"';
+        out += metricName(static_cast<Metric>(m));
+        out += "\":{\"count\":" + to_string(s.count) + ",\"sum_ns\":" + to_string(s.sum_ns) +
+               ",\"p50_ns\":" + to_string(s.percentile(0.5)) + ",\"p99_ns\":" + to_string(s.percentile(0.99)) +
+               ",\"p999_ns\":" + to_string(s.percentile(0.999)) + ",\"max_ns\":" + to_string(s.max_ns) + '}';
+    }
+    out += "},\"counters\":{";
+    for (size_t c = 0; c < COUNTER_COUNT; ++c) {
+        if (c) out += ',';
+        out += '"';
+        out += counterName(static_cast<Counter>(c));
+        out += "\":" + to_string(counters[c]);
+    }
+    out += "}}";
+    return out;
+}
+
+// --------------------------
+// Entity Arena
+// --------------------------
+
+// Bump allocator for the entity graph: chunks grow geometrically and are only
+// freed together when the arena goes away. Not thread-safe; loaders give each
+// thread its own arena.
+class MonotonicArena {
+    static constexpr size_t MAX_CHUNK = 16 << 20;
+
+    vector<unique_ptr<char[]>> chunks;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t next_chunk;
+    size_t reserved = 0;
+
+    void grow(size_t at_least) {
+        size_t size = max(next_chunk, at_least);
+        chunks.emplace_back(new char[size]);
+        cursor = chunks.back().get();
+        limit = cursor + size;
+        reserved += size;
+        next_chunk = min(MAX_CHUNK, next_chunk * 2);
+    }
+
+public:
+    explicit MonotonicArena(size_t first_chunk = 64 << 10) : next_chunk(max<size_t>(first_chunk, 64)) {}
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate(size_t bytes, size_t align) {
+        auto aligned = [&] { return (reinterpret_cast<uintptr_t>(cursor) + align - 1) & ~uintptr_t(align - 1); };
+        if (!cursor || aligned() + bytes > reinterpret_cast<uintptr_t>(limit)) grow(bytes + align);
+        uintptr_t p = aligned();
+        cursor = reinterpret_cast<char*>(p + bytes);
+        return reinterpret_cast<void*>(p);
+    }
+
+    string_view copy(string_view text) {
+        if (text.empty()) return {};
+        char* p = static_cast<char*>(allocate(text.size(), 1));
+        memcpy(p, text.data(), text.size());
+        return {p, text.size()};
+    }
+
+    size_t chunkCount() const { return chunks.size(); }
+    size_t bytesReserved() const { return reserved; }
+};
+
+// Allocator for allocate_shared: object and control block are bumped out of
+// the arena, and the control block's copy of the allocator keeps the arena
+// alive until the last entity allocated from it is released
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    shared_ptr<MonotonicArena> arena;
+
+    explicit ArenaAllocator(shared_ptr<MonotonicArena> arena) : arena(move(arena)) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {} // reclaimed with the arena
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+};
+
+template <typename T, typename... Args>
+shared_ptr<T> makeInArena(const shared_ptr<MonotonicArena>& arena, Args&&... args) {
+    return allocate_shared<T>(ArenaAllocator<T>(arena), forward<Args>(args)...);
+}
+
 // --------------------------
 // Core Domain Models (OOP)
 // --------------------------
 
+constexpr uint32_t perfectHashKey(string_view key, uint32_t seed) {
+    uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+    for (char c : key) {
+        h ^= static_cast<uint8_t>(c);
+        h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+}
+
+// Fixed string -> value table whose hash seed is searched at compile time so
+// every key lands in its own slot: a lookup is one hash and one compare
+template <typename T, size_t N, size_t SLOTS = bit_ceil(N * 2)>
+class PerfectHashMap {
+    array<string_view, SLOTS> keys{};
+    array<T, SLOTS> values{};
+    uint32_t seed = 0;
+
+    static constexpr size_t slot(string_view key, uint32_t seed) { return perfectHashKey(key, seed) & (SLOTS - 1); }
+
+public:
+    constexpr PerfectHashMap(const array<pair<string_view, T>, N>& entries) {
+        for (;; ++seed) {
+            if (seed > (1u << 16)) throw logic_error("No perfect hash seed; widen SLOTS");
+            array<bool, SLOTS> used{};
+            bool collision = false;
+            for (const auto& entry : entries) {
+                size_t i = slot(entry.first, seed);
+                collision |= used[i];
+                used[i] = true;
+            }
+            if (!collision) break;
+        }
+        for (const auto& entry : entries) {
+            size_t i = slot(entry.first, seed);
+            keys[i] = entry.first;
+            values[i] = entry.second;
+        }
+    }
+
+    constexpr const T* find(string_view key) const {
+        size_t i = slot(key, seed);
+        return !keys[i].empty() && keys[i] == key ? &values[i] : nullptr;
+    }
+};
+
 enum class GradeLevel { FRESHMAN, SOPHOMORE, JUNIOR, SENIOR };
 
-GradeLevel stringToGradeLevel(const string& str) {
-    if (str == "FRESHMAN") return GradeLevel::FRESHMAN;
-    if (str == "SOPHOMORE") return GradeLevel::SOPHOMORE;
-    if (str == "JUNIOR") return GradeLevel::JUNIOR;
-    if (str == "SENIOR") return GradeLevel::SENIOR;
-    throw runtime_error("Invalid grade level: " + str);
+constexpr PerfectHashMap<GradeLevel, 4> GRADE_LEVELS({{
+    {"FRESHMAN", GradeLevel::FRESHMAN},
+    {"SOPHOMORE", GradeLevel::SOPHOMORE},
+    {"JUNIOR", GradeLevel::JUNIOR},
+    {"SENIOR", GradeLevel::SENIOR},
+}});
+
+GradeLevel stringToGradeLevel(string_view str) {
+    if (const GradeLevel* level = GRADE_LEVELS.find(str)) return *level;
+    throw runtime_error("Invalid grade level: " + string(str));
+}
+
+constexpr string_view gradeLevelToString(GradeLevel level) {
+    constexpr array<string_view, 4> names = {"FRESHMAN", "SOPHOMORE", "JUNIOR", "SENIOR"};
+    size_t i = static_cast<size_t>(level);
+    return i < names.size() ? names[i] : "UNKNOWN";
 }
 
-string gradeLevelToString(GradeLevel level) {
-    switch(level) {
-        case GradeLevel::FRESHMAN: return "FRESHMAN";
-        case GradeLevel::SOPHOMORE: return "SOPHOMORE";
-        case GradeLevel::JUNIOR: return "JUNIOR";
-        case GradeLevel::SENIOR: return "SENIOR";
+// Specializations that course rules can key on; anything else parses as OTHER
+enum class Specialization : uint8_t {
+    PROGRAMMING_PARADIGMS,
+    NETWORK_AND_COMMUNICATION,
+    BACKEND_DEVELOPMENT,
+    CLOUD_COMPUTING,
+    CAREER_SKILLS,
+    LEADERSHIP_SKILLS,
+    OTHER
+};
+
+constexpr size_t SPECIALIZATION_COUNT = static_cast<size_t>(Specialization::OTHER) + 1;
+
+constexpr PerfectHashMap<Specialization, 6> SPECIALIZATIONS({{
+    {"Programming Paradigms", Specialization::PROGRAMMING_PARADIGMS},
+    {"Network and Communication", Specialization::NETWORK_AND_COMMUNICATION},
+    {"Backend Development", Specialization::BACKEND_DEVELOPMENT},
+    {"Cloud Computing", Specialization::CLOUD_COMPUTING},
+    {"Career Skills", Specialization::CAREER_SKILLS},
+    {"Leadership Skills", Specialization::LEADERSHIP_SKILLS},
+}});
+
+constexpr Specialization parseSpecialization(string_view str) {
+    const Specialization* kind = SPECIALIZATIONS.find(str);
+    return kind ? *kind : Specialization::OTHER;
+}
+
+static_assert(parseSpecialization("Backend Development") == Specialization::BACKEND_DEVELOPMENT);
+static_assert(parseSpecialization("Underwater Basketry") == Specialization::OTHER);
+
+enum class EnrollStatus : uint8_t { OK, FULL, NOT_FOUND, DUPLICATE, PREREQ_MISSING };
+
+string enrollStatusToString(EnrollStatus status) {
+    switch(status) {
+        case EnrollStatus::OK: return "OK";
+        case EnrollStatus::FULL: return "FULL";
+        case EnrollStatus::NOT_FOUND: return "NOT_FOUND";
+        case EnrollStatus::DUPLICATE: return "DUPLICATE";
+        case EnrollStatus::PREREQ_MISSING: return "PREREQ_MISSING";
         default: return "UNKNOWN";
     }
 }
 
+struct AddressView {
+    string_view street;
+    string_view city;
+    string_view state;
+    string_view zip_code;
+};
+
+// Deduplicated (city, state, zip) triples. Rosters repeat a handful of
+// localities on every row, so a Person keeps only a 4-byte id for them.
+// Entries are never removed; the views stay valid for the process lifetime.
+class LocalityTable {
+    struct Locality {
+        string_view city;
+        string_view state;
+        string_view zip_code;
+    };
+
+    deque<string> keys;       // "city\x1fstate\x1fzip"
+    deque<Locality> entries;  // views into keys
+    IdIndex index;
+    mutable shared_mutex mtx;
+
+public:
+    uint32_t intern(string_view city, string_view state, string_view zip_code) {
+        static thread_local string key;
+        key.assign(city).append(1, '\x1f').append(state).append(1, '\x1f').append(zip_code);
+        {
+            shared_lock<shared_mutex> lock(mtx);
+            if (auto slot = index.find(key)) return static_cast<uint32_t>(*slot);
+        }
+        unique_lock<shared_mutex> lock(mtx);
+        if (auto slot = index.find(key)) return static_cast<uint32_t>(*slot);
+        uint32_t handle = entries.size();
+        string_view stored = keys.emplace_back(key);
+        entries.push_back({stored.substr(0, city.size()),
+                           stored.substr(city.size() + 1, state.size()),
+                           stored.substr(city.size() + state.size() + 2)});
+        index.insert(stored, handle);
+        return handle;
+    }
+
+    // City, state and zip of handle; street is left empty
+    AddressView get(uint32_t handle) const {
+        shared_lock<shared_mutex> lock(mtx);
+        const Locality& l = entries.at(handle);
+        return {{}, l.city, l.state, l.zip_code};
+    }
+
+    size_t size() const {
+        shared_lock<shared_mutex> lock(mtx);
+        return entries.size();
+    }
+};
+
+LocalityTable& localities() {
+    static LocalityTable table;
+    return table;
+}
+
+// Receives a person's fields one at a time. Views are only valid for the
+// duration of the call; nothing is allocated to produce them.
+class FieldVisitor {
+public:
+    virtual ~FieldVisitor() = default;
+    virtual void field(string_view key, string_view value) = 0;
+};
+
 struct Address {
     string street;
     string city;
     string state;
     string zip_code;
+
+    AddressView view() const { return {street, city, state, zip_code}; }
 };
 
 class Person {
+public:
+    // Contact details, swapped as a whole on update. A replacement lives in a
+    // small arena of its own, which setProfile hands back once superseded, so
+    // whoever serializes updates decides how long older views stay valid.
+    struct Profile {
+        uint32_t locality; // city/state/zip in localities()
+        string_view name;
+        string_view email;
+        string_view street;
+    };
+
 protected:
-    string id;
-    string name;
-    string email;
-    Address address;
+    SymbolId id;
+    shared_ptr<MonotonicArena> text; // owns the profiles and the bytes behind their views
+    atomic<const Profile*> profile;
+    shared_ptr<MonotonicArena> profile_text; // owns profile once it has been replaced
     system_clock::time_point created_at;
 
+    // Entities built outside a bulk load get a private arena sized to fit
+    static shared_ptr<MonotonicArena> textArena(shared_ptr<MonotonicArena> arena, size_t bytes) {
+        return arena ? move(arena) : make_shared<MonotonicArena>(bytes + sizeof(Profile) + alignof(Profile));
+    }
+
+    template <typename T>
+    static const T* arenaNew(MonotonicArena& arena, T value) {
+        return new (arena.allocate(sizeof(T), alignof(T))) T(value);
+    }
+
+    static const Profile* makeProfile(MonotonicArena& arena, string_view name, string_view email,
+                                      const AddressView& address) {
+        return arenaNew(arena, Profile{localities().intern(address.city, address.state, address.zip_code),
+                                       arena.copy(name), arena.copy(email), arena.copy(address.street)});
+    }
+
 public:
-    Person(string id, string name, string email, Address address)
-        : id(id), name(name), email(email), address(address), created_at(system_clock::now()) {}
+    // Copies name, email and street into arena (or a private one when
+    // null); city/state/zip are interned
+    Person(string_view id, string_view name, string_view email, const AddressView& address,
+           shared_ptr<MonotonicArena> arena = nullptr, size_t extra_bytes = 0)
+        : id(symbols().intern(id)),
+          text(textArena(move(arena), name.size() + email.size() + address.street.size() + extra_bytes)),
+          profile(makeProfile(*text, name, email, address)),
+          created_at(system_clock::now()) {}
 
     virtual ~Person() = default;
 
     virtual string role() const = 0;
 
-    virtual map<string, string> info() const {
-        return {
-            {"id", id},
-            {"name", name},
-            {"email", email},
-            {"street", address.street},
-            {"city", address.city},
-            {"state", address.state},
-            {"zip_code", address.zip_code},
-            {"created_at", to_string(created_at.time_since_epoch().count())}
-        };
+    // Subclasses append their own fields after calling this
+    virtual void visitFields(FieldVisitor& visitor) const {
+        const Profile& current = getProfile();
+        AddressView address = localities().get(current.locality);
+        char created[24];
+        auto end = to_chars(created, created + sizeof(created), created_at.time_since_epoch().count()).ptr;
+        visitor.field("id", getId());
+        visitor.field("name", current.name);
+        visitor.field("email", current.email);
+        visitor.field("street", current.street);
+        visitor.field("city", address.city);
+        visitor.field("state", address.state);
+        visitor.field("zip_code", address.zip_code);
+        visitor.field("created_at", string_view(created, end - created));
     }
 
-    const string& getId() const { return id; }
-    const string& getName() const { return name; }
-    const string& getEmail() const { return email; }
-    const Address& getAddress() const { return address; }
+    // Convenience copy of visitFields; prefer the visitor on hot paths
+    map<string, string> info() const {
+        struct Collect : FieldVisitor {
+            map<string, string> fields;
+            void field(string_view key, string_view value) override { fields.emplace(key, value); }
+        } collect;
+        visitFields(collect);
+        return move(collect.fields);
+    }
+
+    // Replaces name, email and address in one step; readers see either the
+    // old profile or the new one. Returns what backed the old one (null for
+    // the first), to be released once no reader can still use it. Callers
+    // serialize updates.
+    [[nodiscard]] shared_ptr<const void> setProfile(string_view name, string_view email, const AddressView& address) {
+        auto next = make_shared<MonotonicArena>(sizeof(Profile) + alignof(Profile) + name.size() + email.size() +
+                                                address.street.size());
+        profile.store(makeProfile(*next, name, email, address), memory_order_release);
+        return exchange(profile_text, move(next));
+    }
+
+    SymbolId getHandle() const { return id; }
+    const string& getId() const { return symbols().name(id); }
+    // Read once when several fields must come from the same version
+    const Profile& getProfile() const { return *profile.load(memory_order_acquire); }
+    string_view getName() const { return getProfile().name; }
+    string_view getEmail() const { return getProfile().email; }
+    uint32_t getLocality() const { return getProfile().locality; }
+
+    AddressView getAddress() const {
+        const Profile& current = getProfile();
+        AddressView address = localities().get(current.locality);
+        address.street = current.street;
+        return address;
+    }
 };
 
 class Observer {
 public:
     virtual ~Observer() = default;
-    virtual void update(const string& student_id, const string& course_id, optional<float> old_wam, float new_wam) = 0;
+    virtual void update(SymbolId student_id, SymbolId course_id, optional<float> old_wam, float new_wam) = 0;
+    virtual void enrolled(SymbolId /*student_id*/, SymbolId /*course_id*/) {}
+    // wam is the grade the student held in the course, if any
+    virtual void dropped(SymbolId /*student_id*/, SymbolId /*course_id*/, optional<float> /*wam*/) {}
 };
 
 class Observable {
@@ -113,401 +882,6606 @@ public:
         observers.push_back(observer);
     }
 
-    void notify(const string& student_id, const string& course_id, optional<float> old_wam, float new_wam) {
+    void notify(SymbolId student_id, SymbolId course_id, optional<float> old_wam, float new_wam) {
+        SCOPED_TIMER(Metric::OBSERVER_DISPATCH);
         lock_guard<mutex> lock(mtx);
         for (auto observer : observers) {
             observer->update(student_id, course_id, old_wam, new_wam);
         }
     }
+
+    void notifyEnrolled(SymbolId student_id, SymbolId course_id) {
+        SCOPED_TIMER(Metric::OBSERVER_DISPATCH);
+        lock_guard<mutex> lock(mtx);
+        for (auto observer : observers) {
+            observer->enrolled(student_id, course_id);
+        }
+    }
+
+    void notifyDropped(SymbolId student_id, SymbolId course_id, optional<float> wam) {
+        SCOPED_TIMER(Metric::OBSERVER_DISPATCH);
+        lock_guard<mutex> lock(mtx);
+        for (auto observer : observers) {
+            observer->dropped(student_id, course_id, wam);
+        }
+    }
 };
 
-class Student : public Person {
-    GradeLevel grade_level;
-    map<string, optional<float>> courses; // course_id -> WAM score
-    Observable observable;
+// --------------------------
+// Grade Event Bus
+// --------------------------
 
-public:
-    Student(string id, string name, string email, Address address, GradeLevel grade_level)
-        : Person(id, name, email, address), grade_level(grade_level) {}
+struct GradeEvent {
+    enum Kind : uint8_t { ENROLLED, GRADED, DROPPED }; // DROPPED carries the last grade in old_wam
+    SymbolId student_id;
+    SymbolId course_id;
+    float old_wam;
+    float new_wam;
+    Kind kind;
+    bool has_old;
+};
 
-    string role() const override { return "Student"; }
+// Disruptor-style ring shared by a whole College. Producers claim a sequence
+// with one fetch_add and publish by stamping the slot; they never take a lock
+// and only wait when the slowest subscriber is a full ring behind. Each
+// subscriber has its own thread and cursor, drains whatever is published in
+// one batch, and can coalesce repeated grade updates for the same
+// (student, course) within that batch into a single update.
+class EventBus {
+    struct Slot {
+        atomic<uint64_t> stamp{0}; // sequence + 1 once published
+        GradeEvent event;
+    };
 
-    void enroll(const string& course_id) {
-        if (courses.find(course_id) == courses.end()) {
-            courses[course_id] = nullopt;
-            observable.notify(id, course_id, nullopt, 0.0f);
+    struct Subscriber {
+        Observer* observer;
+        bool coalesce;
+        atomic<uint64_t> cursor{0}; // next sequence to consume
+        thread worker;
+    };
+
+    static constexpr size_t MAX_BATCH = 4096;
+
+    unique_ptr<Slot[]> ring;
+    size_t mask;
+    atomic<uint64_t> next{0};
+    vector<unique_ptr<Subscriber>> subscribers;
+    atomic<bool> stopping{false};
+
+    static void backoff(unsigned& idle) {
+        if (++idle < 64) {
+            this_thread::yield();
+        } else {
+            this_thread::sleep_for(microseconds(100));
         }
     }
 
-    void updateWAM(const string& course_id, float wam) {
-        if (wam < 0 || wam > 100) {
-            cerr << RED << "Invalid WAM score. Must be between 0 and 100." << RESET << endl;
-            return;
-        }
-        
-        if (courses.find(course_id) != courses.end()) {
-            auto old_wam = courses[course_id];
-            courses[course_id] = wam;
-            observable.notify(id, course_id, old_wam, wam);
+    uint64_t slowestCursor() const {
+        uint64_t slowest = UINT64_MAX;
+        for (const auto& sub : subscribers) slowest = min(slowest, sub->cursor.load(memory_order_acquire));
+        return slowest;
+    }
+
+    static void deliver(Observer& observer, const GradeEvent& e) {
+        SCOPED_TIMER(Metric::OBSERVER_DISPATCH);
+        if (e.kind == GradeEvent::ENROLLED) {
+            observer.enrolled(e.student_id, e.course_id);
+        } else if (e.kind == GradeEvent::DROPPED) {
+            observer.dropped(e.student_id, e.course_id, e.has_old ? optional<float>(e.old_wam) : nullopt);
+        } else {
+            observer.update(e.student_id, e.course_id, e.has_old ? optional<float>(e.old_wam) : nullopt, e.new_wam);
         }
     }
 
-    float overallWAM() const {
-        vector<float> wams;
-        for (const auto& course : courses) {
-            if (course.second.has_value()) {
-                wams.push_back(course.second.value());
+    void run(Subscriber& sub) {
+        vector<GradeEvent> batch;
+        unordered_map<uint64_t, size_t> latest; // (student, course) -> index in batch
+        batch.reserve(MAX_BATCH);
+        unsigned idle = 0;
+        uint64_t cursor = sub.cursor.load(memory_order_relaxed);
+
+        while (true) {
+            batch.clear();
+            latest.clear();
+            size_t coalesced = 0;
+            while (batch.size() < MAX_BATCH) {
+                const Slot& slot = ring[cursor & mask];
+                if (slot.stamp.load(memory_order_acquire) != cursor + 1) break;
+                const GradeEvent& e = slot.event;
+                uint64_t key = (uint64_t(e.student_id) << 32) | e.course_id;
+                if (sub.coalesce && e.kind == GradeEvent::GRADED) {
+                    auto [it, inserted] = latest.try_emplace(key, batch.size());
+                    if (!inserted) {
+                        batch[it->second].new_wam = e.new_wam; // keep the first old_wam
+                        coalesced++;
+                        cursor++;
+                        continue;
+                    }
+                } else if (e.kind == GradeEvent::DROPPED) {
+                    latest.erase(key); // grades after a drop must not fold into ones before it
+                }
+                batch.push_back(e);
+                cursor++;
+            }
+            if (coalesced) countMetric(Counter::EVENTS_COALESCED, coalesced);
+
+            if (batch.empty()) {
+                if (stopping.load(memory_order_acquire) && cursor == next.load(memory_order_acquire)) return;
+                // Still counts as progress for sync() when only coalesced events were consumed
+                sub.cursor.store(cursor, memory_order_release);
+                backoff(idle);
+                continue;
             }
+            idle = 0;
+            for (const auto& e : batch) {
+                try {
+                    deliver(*sub.observer, e);
+                } catch (const exception& ex) {
+                    cerr << RED << "Event subscriber failed: " << ex.what() << RESET << endl;
+                }
+            }
+            sub.cursor.store(cursor, memory_order_release);
         }
-        
-        if (wams.empty()) return 0.0f;
-        return accumulate(wams.begin(), wams.end(), 0.0f) / wams.size();
     }
 
-    void addObserver(Observer* observer) {
-        observable.addObserver(observer);
+public:
+    explicit EventBus(size_t capacity = 1 << 16) {
+        size_t size = 1;
+        while (size < capacity) size <<= 1;
+        ring.reset(new Slot[size]);
+        mask = size - 1;
+    }
+
+    ~EventBus() {
+        stopping.store(true, memory_order_release);
+        for (auto& sub : subscribers) sub->worker.join();
+    }
+
+    EventBus(const EventBus&) = delete;
+    EventBus& operator=(const EventBus&) = delete;
+
+    // Must be called before anything is published
+    void subscribe(Observer* observer, bool coalesce = false) {
+        auto sub = make_unique<Subscriber>();
+        sub->observer = observer;
+        sub->coalesce = coalesce;
+        sub->cursor.store(next.load(memory_order_relaxed), memory_order_relaxed);
+        Subscriber* raw = sub.get();
+        subscribers.push_back(move(sub));
+        raw->worker = thread([this, raw] { run(*raw); });
+    }
+
+    void publish(const GradeEvent& event) {
+        if (subscribers.empty()) return;
+        uint64_t seq = next.fetch_add(1, memory_order_acq_rel);
+        unsigned idle = 0;
+        while (seq - slowestCursor() > mask) backoff(idle); // ring full
+        Slot& slot = ring[seq & mask];
+        slot.event = event;
+        slot.stamp.store(seq + 1, memory_order_release);
+    }
+
+    // Blocks until every subscriber has processed everything published
+    // before the call; gives readers read-your-writes on derived state
+    void sync() const {
+        uint64_t target = next.load(memory_order_acquire);
+        unsigned idle = 0;
+        while (slowestCursor() < target) backoff(idle);
+    }
+};
+
+// --------------------------
+// Write-Ahead Log
+// --------------------------
+
+// Append-only log of enrollments, drops and grades, replayed over the last
+// snapshot on startup. Each record is a LogRecordHeader followed by the
+// student and course ids. The checksum covers everything after it, so a torn
+// final record from a crash is detected and replay stops there. Records are
+// idempotent when replayed in order, which is what lets a snapshot taken
+// while writers run be combined with the log written during it.
+
+enum class LogOp : uint8_t { ENROLL = 1, DROP = 2, GRADE = 3 };
+
+struct LogRecordHeader {
+    uint32_t checksum;
+    LogOp op;
+    uint8_t has_score;
+    uint16_t student_len;
+    uint16_t course_len;
+    uint16_t reserved;
+    float score;
+};
+
+struct LogEntry {
+    LogOp op;
+    string_view student_id;
+    string_view course_id;
+    optional<float> score;
+};
+
+inline uint32_t logChecksum(const char* data, size_t size) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<uint8_t>(data[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Group commit: appends copy the record into a buffer under a short lock. One
+// flusher thread writes whatever has built up and covers all of it with one
+// fdatasync, so writers that wait for durability at the same time share a
+// sync. Records nobody waits for are still flushed every commit_interval.
+class WriteAheadLog {
+public:
+    enum class Durability {
+        GROUP_COMMIT, // commit() returns once the caller's records are on disk
+        ASYNC         // commit() returns at once; at most commit_interval is at risk
+    };
+
+private:
+    string path;
+    int fd;
+    Durability durability;
+    microseconds commit_interval;
+    mutable mutex mtx;
+    condition_variable wake;   // flusher: a waiter arrived or stopping
+    condition_variable synced; // waiters: durable advanced or a flush ended
+    string pending;            // encoded records not yet written
+    string writing;            // batch being written, reused across flushes
+    uint64_t appended = 0;     // sequence of the last appended record
+    uint64_t durable = 0;      // every record up to here is on disk
+    size_t waiters = 0;
+    bool flushing = false;
+    bool stopping = false;
+    string failure;            // first write or sync error; later commits throw it
+    uint64_t log_id;           // never reused, unlike the object's address
+    thread flusher;
+
+    // Sequence of the last record this thread appended, tagged with the log
+    // it went to
+    struct LastAppended {
+        uint64_t log_id;
+        uint64_t seq;
+    };
+    static inline thread_local LastAppended last_appended{0, 0};
+
+    static uint64_t nextLogId() {
+        static atomic<uint64_t> next{1};
+        return next.fetch_add(1, memory_order_relaxed);
+    }
+
+    static int openForAppend(const string& path) {
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            throw runtime_error("Could not open log: " + path);
+        }
+        return fd;
+    }
+
+    static void writeAll(int fd, string_view data) {
+        while (!data.empty()) {
+            ssize_t n = ::write(fd, data.data(), data.size());
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) throw runtime_error(string("Log write failed: ") + strerror(errno));
+            data.remove_prefix(size_t(n));
+        }
+        if (fdatasync(fd) != 0) throw runtime_error(string("Log sync failed: ") + strerror(errno));
+    }
+
+    static void encode(string& out, const LogEntry& entry) {
+        LogRecordHeader header{0, entry.op, entry.score.has_value(), uint16_t(entry.student_id.size()),
+                               uint16_t(entry.course_id.size()), 0, entry.score.value_or(0.0f)};
+        size_t start = out.size();
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.append(entry.student_id);
+        out.append(entry.course_id);
+        header.checksum = logChecksum(out.data() + start + sizeof(uint32_t), out.size() - start - sizeof(uint32_t));
+        memcpy(out.data() + start, &header.checksum, sizeof(uint32_t));
+    }
+
+    // This thread's last record in this log. If its last append went to
+    // another log, everything appended so far is covered instead.
+    uint64_t lastAppended() const {
+        if (last_appended.log_id == log_id) return last_appended.seq;
+        lock_guard<mutex> lock(mtx);
+        return appended;
+    }
+
+    void run() {
+        unique_lock<mutex> lock(mtx);
+        while (true) {
+            // While flushing is set here, rotate() owns the file
+            wake.wait_for(lock, commit_interval, [&] { return !flushing && (stopping || (waiters && !pending.empty())); });
+            if (flushing) continue;
+            if (pending.empty()) {
+                if (stopping) return;
+                continue;
+            }
+            swap(pending, writing);
+            uint64_t batch_end = appended;
+            flushing = true;
+            lock.unlock();
+            string error;
+            try {
+                SCOPED_TIMER(Metric::LOG_SYNC);
+                writeAll(fd, writing);
+            } catch (const exception& e) {
+                error = e.what();
+            }
+            countMetric(Counter::LOG_SYNCS);
+            writing.clear();
+            lock.lock();
+            flushing = false;
+            if (error.empty()) {
+                durable = batch_end;
+            } else if (failure.empty()) {
+                failure = error;
+            }
+            synced.notify_all();
+        }
+    }
+
+public:
+    explicit WriteAheadLog(const string& path, Durability durability = Durability::GROUP_COMMIT,
+                           microseconds commit_interval = milliseconds(2))
+        : path(path), fd(openForAppend(path)), durability(durability), commit_interval(commit_interval),
+          log_id(nextLogId()) {
+        flusher = thread([this] { run(); });
+    }
+
+    ~WriteAheadLog() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        wake.notify_one();
+        flusher.join();
+        ::close(fd);
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    const string& getPath() const { return path; }
+
+    // Buffers one record and returns its sequence number. Ids longer than
+    // the record's 16-bit length fields are rejected.
+    uint64_t append(const LogEntry& entry) {
+        if (entry.student_id.size() > UINT16_MAX || entry.course_id.size() > UINT16_MAX) {
+            throw runtime_error("Id too long for the log");
+        }
+        lock_guard<mutex> lock(mtx);
+        encode(pending, entry);
+        countMetric(Counter::LOG_RECORDS);
+        last_appended = {log_id, ++appended};
+        return appended;
+    }
+
+    // Blocks until record `seq` and everything before it are on disk
+    void waitDurable(uint64_t seq) {
+        unique_lock<mutex> lock(mtx);
+        seq = min(seq, appended);
+        if (durable >= seq) return;
+        waiters++;
+        wake.notify_one();
+        synced.wait(lock, [&] { return durable >= seq || !failure.empty(); });
+        waiters--;
+        if (durable < seq) throw runtime_error(failure);
+    }
+
+    // Makes this thread's records durable according to the log's policy
+    void commit() {
+        if (durability == Durability::GROUP_COMMIT) waitDurable(lastAppended());
+    }
+
+    // commit() for records appended by any thread, e.g. by pool workers
+    void commitAll() {
+        if (durability == Durability::GROUP_COMMIT) flush();
+    }
+
+    // Everything appended by any thread so far, regardless of policy
+    void flush() {
+        uint64_t seq;
+        {
+            lock_guard<mutex> lock(mtx);
+            seq = appended;
+        }
+        waitDurable(seq);
+    }
+
+    // First half of a checkpoint: makes the current file complete and durable,
+    // then sends new records to path + ".next". The write and sync run
+    // outside the lock, so appends carry on into pending meanwhile.
+    void rotate() {
+        uint64_t batch_end;
+        {
+            unique_lock<mutex> lock(mtx);
+            synced.wait(lock, [&] { return !flushing; });
+            swap(pending, writing);
+            batch_end = appended;
+            flushing = true;
+        }
+        int next = -1;
+        string error;
+        try {
+            if (!writing.empty()) writeAll(fd, writing);
+            next = openForAppend(path + ".next");
+        } catch (const exception& e) {
+            error = e.what();
+        }
+        writing.clear();
+        {
+            lock_guard<mutex> lock(mtx);
+            flushing = false;
+            if (error.empty()) {
+                ::close(fd);
+                fd = next;
+                durable = batch_end;
+            } else if (failure.empty()) {
+                failure = error;
+            }
+            synced.notify_all();
+        }
+        wake.notify_one();
+        if (!error.empty()) throw runtime_error(error);
+    }
+
+    // Second half, once the snapshot covering the old file is durable: the
+    // ".next" file replaces it
+    void commitRotation() {
+        lock_guard<mutex> lock(mtx);
+        if (::rename((path + ".next").c_str(), path.c_str()) != 0) {
+            throw runtime_error("Could not replace log: " + path);
+        }
+    }
+
+    // Calls apply for every intact record in file order and returns how many
+    // there were; a missing file has none. Defined after MappedFile.
+    static size_t replay(const string& filename, const function<void(const LogEntry&)>& apply);
+};
+
+// course handle -> WAM score, sorted by handle
+using CourseScores = vector<pair<SymbolId, optional<float>>>;
+
+class Student : public Person {
+    atomic<GradeLevel> grade_level;
+    CourseScores courses;
+    double wam_sum = 0.0;     // running total of graded scores
+    uint32_t graded_count = 0;
+    EventBus* bus = nullptr;          // set by the owning College
+    WriteAheadLog* wal = nullptr;     // likewise, once it opens a log
+    unique_ptr<Observable> observers; // only allocated for direct observers
+    bool retired = false;             // deleted from its College; under the stripe
+
+    // Caller holds the student's stripe, so records for one student are
+    // logged in the order they were applied
+    void publishEnrolled(SymbolId course_id) {
+        if (wal) wal->append({LogOp::ENROLL, getId(), symbols().name(course_id), nullopt});
+        if (bus) bus->publish({id, course_id, 0.0f, 0.0f, GradeEvent::ENROLLED, false});
+        if (observers) observers->notifyEnrolled(id, course_id);
+    }
+
+    void publishGraded(SymbolId course_id, optional<float> old_wam, float wam) {
+        if (wal) wal->append({LogOp::GRADE, getId(), symbols().name(course_id), wam});
+        if (bus) bus->publish({id, course_id, old_wam.value_or(0.0f), wam, GradeEvent::GRADED, old_wam.has_value()});
+        if (observers) observers->notify(id, course_id, old_wam, wam);
+    }
+
+    void publishDropped(SymbolId course_id, optional<float> wam) {
+        if (wal) wal->append({LogOp::DROP, getId(), symbols().name(course_id), nullopt});
+        if (bus) bus->publish({id, course_id, wam.value_or(0.0f), 0.0f, GradeEvent::DROPPED, wam.has_value()});
+        if (observers) observers->notifyDropped(id, course_id, wam);
+    }
+
+    // First entry whose handle is not less than course_id
+    template <typename Scores>
+    static auto lowerBound(Scores& scores, SymbolId course_id) {
+        return lower_bound(scores.begin(), scores.end(), course_id,
+            [](const pair<SymbolId, optional<float>>& c, SymbolId h) { return c.first < h; });
+    }
+
+public:
+    Student(string_view id, string_view name, string_view email, const AddressView& address, GradeLevel grade_level,
+            shared_ptr<MonotonicArena> arena = nullptr)
+        : Person(id, name, email, address, move(arena)), grade_level(grade_level) {}
+
+    Student(string_view id, string_view name, string_view email, const Address& address, GradeLevel grade_level)
+        : Student(id, name, email, address.view(), grade_level) {}
+
+    string role() const override { return "Student"; }
+
+    // Mutators serialize on the student's lock stripe; observers run under it.
+    // Returns false, changing nothing, once the student has been retired.
+    bool enroll(SymbolId course_id) {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        if (retired) return false;
+        auto it = lowerBound(courses, course_id);
+        if (it == courses.end() || it->first != course_id) {
+            courses.emplace(it, course_id, nullopt);
+            publishEnrolled(course_id);
+        }
+        return true;
+    }
+
+    bool enroll(string_view course_id) {
+        return enroll(symbols().intern(course_id));
+    }
+
+    // Marks the student deleted and returns the courses it holds. Any
+    // enrollment that reaches the student afterwards is refused, so the
+    // returned list covers every roster it can be on.
+    CourseScores retire() {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        retired = true;
+        return courses;
+    }
+
+    // Leaves the course, taking its grade out of the running WAM. Returns
+    // false if the student was not enrolled.
+    bool drop(SymbolId course_id) {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        auto it = lowerBound(courses, course_id);
+        if (it == courses.end() || it->first != course_id) return false;
+        auto wam = it->second;
+        courses.erase(it);
+        if (wam) {
+            wam_sum -= *wam;
+            graded_count--;
+        }
+        publishDropped(course_id, wam);
+        return true;
+    }
+
+    void updateWAM(SymbolId course_id, float wam) {
+        if (!isfinite(wam) || wam < 0 || wam > 100) {
+            cerr << RED << "Invalid WAM score. Must be between 0 and 100." << RESET << endl;
+            return;
+        }
+        
+        SCOPED_TIMER(Metric::WAM_UPDATE);
+        WriteAheadLog* logged = nullptr;
+        {
+            lock_guard<mutex> lock(studentLocks().forKey(id));
+            auto it = lowerBound(courses, course_id);
+            if (it != courses.end() && it->first == course_id) {
+                auto old_wam = it->second;
+                it->second = wam;
+                wam_sum += wam - old_wam.value_or(0.0f);
+                if (!old_wam) graded_count++;
+                publishGraded(course_id, old_wam, wam);
+                logged = wal;
+            }
+        }
+        // Outside the stripe, so concurrent graders share the sync
+        if (logged) logged->commit();
+    }
+
+    void updateWAM(string_view course_id, float wam) {
+        // An id nobody has interned cannot be one of this student's courses
+        auto handle = symbols().lookup(course_id);
+        if (handle) {
+            updateWAM(*handle, wam);
+        } else if (!isfinite(wam) || wam < 0 || wam > 100) {
+            cerr << RED << "Invalid WAM score. Must be between 0 and 100." << RESET << endl;
+        }
+    }
+
+    // Courses graded at or above pass_mark, taken under the student's stripe
+    vector<SymbolId> passedCourses(float pass_mark) const {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        vector<SymbolId> passed;
+        for (const auto& [course_id, wam] : courses) {
+            if (wam && *wam >= pass_mark) passed.push_back(course_id);
+        }
+        return passed;
+    }
+
+    bool isEnrolledIn(SymbolId course_id) const {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        auto it = lowerBound(courses, course_id);
+        return it != courses.end() && it->first == course_id;
+    }
+
+    // Under the stripe: updateWAM and drop change both accumulators together
+    float overallWAM() const {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        if (graded_count == 0) return 0.0f;
+        return static_cast<float>(wam_sum / graded_count);
+    }
+
+    // Synchronous observer, called under the student's lock stripe
+    void addObserver(Observer* observer) {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        if (!observers) observers = make_unique<Observable>();
+        observers->addObserver(observer);
+    }
+
+    void attachEventBus(EventBus* event_bus) {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        bus = event_bus;
+    }
+
+    // Enrollments and drops are only appended here; College commits them
+    void attachLog(WriteAheadLog* log) {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        wal = log;
+    }
+
+    const CourseScores& getCourses() const { return courses; }
+
+    // Copy taken under the stripe, for readers racing writers (checkpoints)
+    CourseScores copyCourses() const {
+        lock_guard<mutex> lock(studentLocks().forKey(id));
+        return courses;
+    }
+
+    GradeLevel getGradeLevel() const { return grade_level.load(memory_order_relaxed); }
+    void setGradeLevel(GradeLevel level) { grade_level.store(level, memory_order_relaxed); }
+
+    void visitFields(FieldVisitor& visitor) const override {
+        Person::visitFields(visitor);
+        visitor.field("grade_level", gradeLevelToString(getGradeLevel()));
+    }
+};
+
+class Teacher : public Person {
+public:
+    // Swapped as a whole like Person::Profile, and reclaimed the same way
+    struct Appointment {
+        string_view department;
+        string_view specialization;
+        Specialization kind;
+    };
+
+private:
+    atomic<const Appointment*> appointment;
+    shared_ptr<MonotonicArena> appointment_text; // owns appointment once replaced
+    HandleSet assigned_courses;
+    mutable mutex courses_mtx; // guards assigned_courses
+
+    static const Appointment* makeAppointment(MonotonicArena& arena, string_view department,
+                                              string_view specialization) {
+        return arenaNew(arena, Appointment{arena.copy(department), arena.copy(specialization),
+                                           parseSpecialization(specialization)});
+    }
+
+public:
+    Teacher(string_view id, string_view name, string_view email, const AddressView& address,
+            string_view department, string_view specialization, shared_ptr<MonotonicArena> arena = nullptr)
+        : Person(id, name, email, address, move(arena),
+                 department.size() + specialization.size() + sizeof(Appointment) + alignof(Appointment)),
+          appointment(makeAppointment(*text, department, specialization)) {}
+
+    Teacher(string_view id, string_view name, string_view email, const Address& address,
+            string_view department, string_view specialization)
+        : Teacher(id, name, email, address.view(), department, specialization) {}
+
+    string role() const override { return "Teacher"; }
+
+    void assignCourse(SymbolId course_id) {
+        lock_guard<mutex> lock(courses_mtx);
+        assigned_courses.insert(course_id);
+    }
+
+    void assignCourse(string_view course_id) {
+        assignCourse(symbols().intern(course_id));
+    }
+
+    int courseLoad() const {
+        lock_guard<mutex> lock(courses_mtx);
+        return assigned_courses.size();
+    }
+
+    bool teaches(SymbolId course_id) const {
+        lock_guard<mutex> lock(courses_mtx);
+        return assigned_courses.contains(course_id);
+    }
+
+    // Returns the old appointment's backing like setProfile; callers
+    // serialize updates
+    [[nodiscard]] shared_ptr<const void> setAppointment(string_view department, string_view specialization) {
+        auto next = make_shared<MonotonicArena>(sizeof(Appointment) + alignof(Appointment) + department.size() +
+                                                specialization.size());
+        appointment.store(makeAppointment(*next, department, specialization), memory_order_release);
+        return exchange(appointment_text, move(next));
+    }
+
+    const Appointment& getAppointment() const { return *appointment.load(memory_order_acquire); }
+    string_view getDepartment() const { return getAppointment().department; }
+    string_view getSpecialization() const { return getAppointment().specialization; }
+    Specialization getSpecializationKind() const { return getAppointment().kind; }
+
+    void visitFields(FieldVisitor& visitor) const override {
+        Person::visitFields(visitor);
+        const Appointment& current = getAppointment();
+        visitor.field("department", current.department);
+        visitor.field("specialization", current.specialization);
+    }
+    // A copy, since assignments can change while it is read
+    HandleSet getAssignedCourses() const {
+        lock_guard<mutex> lock(courses_mtx);
+        return assigned_courses;
+    }
+};
+
+class Course {
+    static constexpr size_t MEMBER_SHARDS = 8;
+
+    // Roster shard; a student always lands in the shard picked by its handle
+    struct alignas(64) MemberShard {
+        mutable mutex mtx;
+        HandleSet members;
+    };
+
+    SymbolId id;
+    string name;
+    int credits;
+    int capacity;
+    atomic<int> seats_taken{0};    // committed + tentatively reserved
+    atomic<int> enrolled_count{0}; // committed only
+    array<MemberShard, MEMBER_SHARDS> enrolled_students;
+    HandleSet prerequisites;
+    deque<SymbolId> waitlist;
+    mutable mutex waitlist_mtx;
+
+    MemberShard& shardFor(SymbolId student_id) {
+        return enrolled_students[(student_id * 2654435761u) % MEMBER_SHARDS];
+    }
+
+    const MemberShard& shardFor(SymbolId student_id) const {
+        return enrolled_students[(student_id * 2654435761u) % MEMBER_SHARDS];
+    }
+
+public:
+    Course(string_view id, string name, int credits, int capacity = 30)
+        : id(symbols().intern(id)), name(move(name)), credits(credits), capacity(capacity) {}
+
+    void addPrerequisite(SymbolId course_id) {
+        prerequisites.insert(course_id);
+    }
+
+    void addPrerequisite(string_view course_id) {
+        addPrerequisite(symbols().intern(course_id));
+    }
+
+    // Tentatively takes a seat with a CAS on the seat counter. Every
+    // successful reserve must be followed by commitSeat or rollbackSeat.
+    bool reserveSeat() {
+        int taken = seats_taken.load(memory_order_relaxed);
+        while (taken < capacity) {
+            if (seats_taken.compare_exchange_weak(taken, taken + 1, memory_order_acq_rel)) return true;
+        }
+        return false;
+    }
+
+    void rollbackSeat() {
+        seats_taken.fetch_sub(1, memory_order_acq_rel);
+    }
+
+    // Turns a reservation into a roster entry. If the student is already on
+    // the roster the reservation is released, still under the shard lock,
+    // and DUPLICATE returned.
+    EnrollStatus commitSeat(SymbolId student_id) {
+        auto& shard = shardFor(student_id);
+        {
+            lock_guard<mutex> lock(shard.mtx);
+            if (!shard.members.insert(student_id)) {
+                rollbackSeat();
+                return EnrollStatus::DUPLICATE;
+            }
+        }
+        enrolled_count.fetch_add(1, memory_order_relaxed);
+        return EnrollStatus::OK;
+    }
+
+    // Check, reserve and insert under the student's roster shard, so two
+    // enrolls of the same student race to OK and DUPLICATE, never FULL
+    EnrollStatus tryEnroll(SymbolId student_id) {
+        auto& shard = shardFor(student_id);
+        {
+            lock_guard<mutex> lock(shard.mtx);
+            if (shard.members.contains(student_id)) return EnrollStatus::DUPLICATE;
+            if (!reserveSeat()) return EnrollStatus::FULL;
+            shard.members.insert(student_id);
+        }
+        enrolled_count.fetch_add(1, memory_order_relaxed);
+        return EnrollStatus::OK;
+    }
+
+    // Already being enrolled counts as success
+    bool enrollStudent(SymbolId student_id) {
+        return tryEnroll(student_id) != EnrollStatus::FULL;
+    }
+
+    bool enrollStudent(string_view student_id) {
+        return enrollStudent(symbols().intern(student_id));
+    }
+
+    // Seats a run of students in order; out[i] receives the outcome for
+    // student_ids[i]
+    void enrollGroup(span<const SymbolId> student_ids, span<EnrollStatus> out) {
+        for (size_t i = 0; i < student_ids.size(); ++i) {
+            out[i] = tryEnroll(student_ids[i]);
+        }
+    }
+
+    // Roster entry restored from a snapshot or replayed from the log. Skips
+    // the capacity check made when it was first committed: log order can run
+    // ahead of the drop that freed the seat, and a snapshot keeps rosters a
+    // later capacity change left over-full. Returns false on a duplicate.
+    bool restoreStudent(SymbolId student_id) {
+        auto& shard = shardFor(student_id);
+        {
+            lock_guard<mutex> lock(shard.mtx);
+            if (!shard.members.insert(student_id)) return false;
+        }
+        seats_taken.fetch_add(1, memory_order_acq_rel);
+        enrolled_count.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Removes a committed roster entry and frees its seat
+    bool dropStudent(SymbolId student_id) {
+        auto& shard = shardFor(student_id);
+        {
+            lock_guard<mutex> lock(shard.mtx);
+            if (!shard.members.erase(student_id)) return false;
+        }
+        enrolled_count.fetch_sub(1, memory_order_relaxed);
+        rollbackSeat();
+        return true;
+    }
+
+    bool isEnrolled(SymbolId student_id) const {
+        auto& shard = shardFor(student_id);
+        lock_guard<mutex> lock(shard.mtx);
+        return shard.members.contains(student_id);
+    }
+
+    // Waitlist for students turned away while the course is full
+    bool joinWaitlist(SymbolId student_id) {
+        lock_guard<mutex> lock(waitlist_mtx);
+        if (find(waitlist.begin(), waitlist.end(), student_id) != waitlist.end()) return false;
+        waitlist.push_back(student_id);
+        return true;
+    }
+
+    optional<SymbolId> popWaitlist() {
+        lock_guard<mutex> lock(waitlist_mtx);
+        if (waitlist.empty()) return nullopt;
+        SymbolId next = waitlist.front();
+        waitlist.pop_front();
+        return next;
+    }
+
+    size_t waitlistSize() const {
+        lock_guard<mutex> lock(waitlist_mtx);
+        return waitlist.size();
+    }
+
+    // Zero, not negative, while a restored roster is over capacity
+    int availableSeats() const {
+        return max(0, capacity - seats_taken.load(memory_order_acquire));
+    }
+
+    SymbolId getHandle() const { return id; }
+    const string& getId() const { return symbols().name(id); }
+    const string& getName() const { return name; }
+    int getCredits() const { return credits; }
+    int getCapacity() const { return capacity; }
+    int getEnrolledCount() const { return enrolled_count.load(memory_order_acquire); }
+    const HandleSet& getPrerequisites() const { return prerequisites; }
+
+    // Sorted copy of the roster, merged from the shards
+    vector<SymbolId> getEnrolledStudents() const {
+        vector<SymbolId> all;
+        for (const auto& shard : enrolled_students) {
+            lock_guard<mutex> lock(shard.mtx);
+            all.insert(all.end(), shard.members.begin(), shard.members.end());
+        }
+        sort(all.begin(), all.end());
+        return all;
+    }
+};
+
+// Holds a tentative seat; released on destruction unless committed
+class SeatReservation {
+    Course* course = nullptr;
+
+public:
+    SeatReservation() = default;
+    explicit SeatReservation(Course& c) : course(c.reserveSeat() ? &c : nullptr) {}
+    SeatReservation(SeatReservation&& other) noexcept : course(exchange(other.course, nullptr)) {}
+    SeatReservation& operator=(SeatReservation&& other) noexcept {
+        if (this != &other) {
+            release();
+            course = exchange(other.course, nullptr);
+        }
+        return *this;
+    }
+    ~SeatReservation() { release(); }
+
+    explicit operator bool() const { return course != nullptr; }
+
+    EnrollStatus commit(SymbolId student_id) {
+        if (!course) return EnrollStatus::FULL;
+        return exchange(course, nullptr)->commitSeat(student_id);
+    }
+
+    void release() {
+        if (course) exchange(course, nullptr)->rollbackSeat();
+    }
+};
+
+// --------------------------
+// Columnar Grade Store
+// --------------------------
+
+// Sum of scores[i] * mask[i] and of mask[i], where mask is 1.0f for graded rows
+inline void maskedSum(const float* scores, const float* mask, size_t n, float& sum, float& count) {
+    size_t i = 0;
+    float s = 0.0f, c = 0.0f;
+#if defined(__SSE2__)
+    __m128 vs = _mm_setzero_ps();
+    __m128 vc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 m = _mm_loadu_ps(mask + i);
+        vs = _mm_add_ps(vs, _mm_mul_ps(_mm_loadu_ps(scores + i), m));
+        vc = _mm_add_ps(vc, m);
+    }
+    alignas(16) float ts[4], tc[4];
+    _mm_store_ps(ts, vs);
+    _mm_store_ps(tc, vc);
+    s = ts[0] + ts[1] + ts[2] + ts[3];
+    c = tc[0] + tc[1] + tc[2] + tc[3];
+#endif
+    for (; i < n; ++i) {
+        s += scores[i] * mask[i];
+        c += mask[i];
+    }
+    sum = s;
+    count = c;
+}
+
+// One row per (student, course) enrollment, kept in parallel arrays so WAM
+// aggregates are single passes over contiguous memory. Rows are appended by
+// the observer hooks, fed from College's event bus. Rows are keyed by handle,
+// not by slot in a view, so readers on any pinned view pair each student with
+// its own grades.
+class GradeStore : public Observer {
+    vector<SymbolId> student_ids;
+    vector<SymbolId> course_ids;
+    vector<float> scores;
+    vector<float> has_score;          // 1.0f once graded, else 0.0f
+    unordered_map<uint64_t, uint32_t> row_of; // (student handle, course handle) -> row
+    unordered_set<SymbolId> registered;
+    mutable mutex mtx;
+
+    static uint64_t key(SymbolId student_id, SymbolId course_id) {
+        return (uint64_t(student_id) << 32) | course_id;
+    }
+
+    // Caller must hold mtx
+    uint32_t rowFor(SymbolId student_id, SymbolId course_id) {
+        auto existing = row_of.find(key(student_id, course_id));
+        if (existing != row_of.end()) return existing->second;
+        // Throws for an unregistered student before any column grows
+        if (!registered.count(student_id)) throw out_of_range("Student not in the grade store");
+        uint32_t row = uint32_t(scores.size());
+        student_ids.push_back(student_id);
+        course_ids.push_back(course_id);
+        scores.push_back(0.0f);
+        has_score.push_back(0.0f);
+        row_of.emplace(key(student_id, course_id), row);
+        return row;
+    }
+
+    // Caller must hold mtx. The last row fills the hole.
+    void removeRowLocked(SymbolId student_id, SymbolId course_id) {
+        auto it = row_of.find(key(student_id, course_id));
+        if (it == row_of.end()) return;
+        uint32_t row = it->second, last = uint32_t(scores.size() - 1);
+        row_of.erase(it);
+        if (row != last) {
+            student_ids[row] = student_ids[last];
+            course_ids[row] = course_ids[last];
+            scores[row] = scores[last];
+            has_score[row] = has_score[last];
+            row_of[key(student_ids[row], course_ids[row])] = row;
+        }
+        student_ids.pop_back();
+        course_ids.pop_back();
+        scores.pop_back();
+        has_score.pop_back();
+    }
+
+public:
+    // Seeds rows from the student's current courses; later changes arrive
+    // as events
+    void addStudent(const Student& student) {
+        // Copied before mtx: grade events take the stripe first, then mtx
+        auto courses = student.copyCourses();
+        lock_guard<mutex> lock(mtx);
+        registered.insert(student.getHandle());
+        for (const auto& [course_id, wam] : courses) {
+            uint32_t row = rowFor(student.getHandle(), course_id);
+            scores[row] = wam.value_or(0.0f);
+            has_score[row] = wam.has_value() ? 1.0f : 0.0f;
+        }
+    }
+
+    // Drops the student's rows, given its courses
+    void removeStudent(SymbolId student_id, const CourseScores& courses) {
+        lock_guard<mutex> lock(mtx);
+        for (const auto& entry : courses) removeRowLocked(student_id, entry.first);
+        registered.erase(student_id);
+    }
+
+    void enrolled(SymbolId student_id, SymbolId course_id) override {
+        lock_guard<mutex> lock(mtx);
+        rowFor(student_id, course_id);
+    }
+
+    void dropped(SymbolId student_id, SymbolId course_id, optional<float>) override {
+        lock_guard<mutex> lock(mtx);
+        removeRowLocked(student_id, course_id);
+    }
+
+    void update(SymbolId student_id, SymbolId course_id, optional<float>, float new_wam) override {
+        lock_guard<mutex> lock(mtx);
+        uint32_t row = rowFor(student_id, course_id);
+        scores[row] = new_wam;
+        has_score[row] = 1.0f;
+    }
+
+    // Mean of every graded row across the college
+    float collegeWAM() const {
+        lock_guard<mutex> lock(mtx);
+        float sum, count;
+        maskedSum(scores.data(), has_score.data(), scores.size(), sum, count);
+        return count > 0 ? sum / count : 0.0f;
+    }
+
+    // Overall WAM of each listed student, 0 for students with no grades
+    vector<float> overallWAMs(span<const SymbolId> students) const {
+        return weightedWAMs(students, [](SymbolId) { return 1.0f; });
+    }
+
+    // WAM of each listed student with every row weighted by weight(course_id).
+    // Row products are taken four at a time; the per-handle adds stay scalar
+    // since SSE2 has no scatter.
+    template <typename Weight>
+    vector<float> weightedWAMs(span<const SymbolId> students, Weight weight) const {
+        SymbolId limit = 0;
+        for (SymbolId student_id : students) limit = max(limit, student_id + 1);
+        vector<float> sums(limit, 0.0f), weights(limit, 0.0f);
+        lock_guard<mutex> lock(mtx);
+        auto accumulate = [&](size_t i, float product, float w) {
+            if (student_ids[i] >= limit) return; // not asked for
+            sums[student_ids[i]] += product;
+            weights[student_ids[i]] += w;
+        };
+        size_t i = 0;
+#if defined(__SSE2__)
+        alignas(16) float products[4], ws[4];
+        for (; i + 4 <= scores.size(); i += 4) {
+            __m128 w = _mm_mul_ps(_mm_setr_ps(weight(course_ids[i]), weight(course_ids[i + 1]),
+                                              weight(course_ids[i + 2]), weight(course_ids[i + 3])),
+                                  _mm_loadu_ps(has_score.data() + i));
+            _mm_store_ps(products, _mm_mul_ps(_mm_loadu_ps(scores.data() + i), w));
+            _mm_store_ps(ws, w);
+            for (size_t j = 0; j < 4; ++j) accumulate(i + j, products[j], ws[j]);
+        }
+#endif
+        for (; i < scores.size(); ++i) {
+            float w = weight(course_ids[i]) * has_score[i];
+            accumulate(i, scores[i] * w, w);
+        }
+        vector<float> wams(students.size());
+        for (size_t i = 0; i < students.size(); ++i) {
+            SymbolId s = students[i];
+            wams[i] = weights[s] > 0 ? sums[s] / weights[s] : 0.0f;
+        }
+        return wams;
+    }
+
+    // (course handle, mean graded score) for every course with at least one grade
+    vector<pair<SymbolId, float>> courseAverages() const {
+        lock_guard<mutex> lock(mtx);
+        vector<float> sums(symbols().size(), 0.0f), counts(symbols().size(), 0.0f);
+        for (size_t i = 0; i < scores.size(); ++i) {
+            sums[course_ids[i]] += scores[i] * has_score[i];
+            counts[course_ids[i]] += has_score[i];
+        }
+        vector<pair<SymbolId, float>> averages;
+        for (SymbolId c = 0; c < counts.size(); ++c) {
+            if (counts[c] > 0) averages.emplace_back(c, sums[c] / counts[c]);
+        }
+        return averages;
+    }
+
+    size_t rows() const {
+        lock_guard<mutex> lock(mtx);
+        return scores.size();
+    }
+};
+
+// --------------------------
+// Incremental WAM Aggregates
+// --------------------------
+
+struct WAMAggregate {
+    double sum = 0.0;
+    uint32_t count = 0;
+
+    void apply(optional<float> old_wam, float new_wam) {
+        sum += new_wam - old_wam.value_or(0.0f);
+        if (!old_wam) count++;
+    }
+
+    void retract(float wam) {
+        sum -= wam;
+        count--;
+    }
+
+    float mean() const { return count ? static_cast<float>(sum / count) : 0.0f; }
+};
+
+// Running per-course and per-department WAM totals, updated in O(1) on every
+// grade change. A course belongs to the departments of the teachers assigned
+// to it; College reports those assignments through assignCourse/addTeacher.
+class WAMAggregator : public Observer {
+    unordered_map<SymbolId, WAMAggregate> by_course;
+    unordered_map<SymbolId, vector<uint32_t>> course_departments;
+    unordered_map<string, uint32_t> department_index;
+    vector<string> department_names;
+    vector<WAMAggregate> by_department;
+    mutable mutex mtx;
+
+    // Caller must hold mtx
+    void applyLocked(SymbolId course_id, optional<float> old_wam, float new_wam) {
+        by_course[course_id].apply(old_wam, new_wam);
+        auto depts = course_departments.find(course_id);
+        if (depts == course_departments.end()) return;
+        for (uint32_t d : depts->second) {
+            by_department[d].apply(old_wam, new_wam);
+        }
+    }
+
+    void retractLocked(SymbolId course_id, float wam) {
+        by_course[course_id].retract(wam);
+        auto depts = course_departments.find(course_id);
+        if (depts == course_departments.end()) return;
+        for (uint32_t d : depts->second) by_department[d].retract(wam);
+    }
+
+public:
+    void addStudent(const Student& student) {
+        lock_guard<mutex> lock(mtx);
+        for (const auto& [course_id, wam] : student.getCourses()) {
+            if (wam) applyLocked(course_id, nullopt, *wam);
+        }
+    }
+
+    // Takes a departing student's grades back out of every total
+    void removeStudent(const CourseScores& courses) {
+        lock_guard<mutex> lock(mtx);
+        for (const auto& [course_id, wam] : courses) {
+            if (wam) retractLocked(course_id, *wam);
+        }
+    }
+
+    void update(SymbolId, SymbolId course_id, optional<float> old_wam, float new_wam) override {
+        lock_guard<mutex> lock(mtx);
+        applyLocked(course_id, old_wam, new_wam);
+    }
+
+    void dropped(SymbolId, SymbolId course_id, optional<float> wam) override {
+        if (!wam) return;
+        lock_guard<mutex> lock(mtx);
+        retractLocked(course_id, *wam);
+    }
+
+    // Links course_id to department; grades already recorded for the course
+    // are folded into the department total the first time the link is made
+    void linkCourse(SymbolId course_id, string_view department) {
+        lock_guard<mutex> lock(mtx);
+        auto [it, inserted] = department_index.try_emplace(string(department), uint32_t(department_names.size()));
+        if (inserted) {
+            department_names.emplace_back(department);
+            by_department.emplace_back();
+        }
+        auto& depts = course_departments[course_id];
+        if (find(depts.begin(), depts.end(), it->second) != depts.end()) return;
+        depts.push_back(it->second);
+        auto course = by_course.find(course_id);
+        if (course != by_course.end()) {
+            by_department[it->second].sum += course->second.sum;
+            by_department[it->second].count += course->second.count;
+        }
+    }
+
+    // Reverses linkCourse once no teacher in department teaches the course
+    void unlinkCourse(SymbolId course_id, string_view department) {
+        lock_guard<mutex> lock(mtx);
+        auto dept = department_index.find(string(department));
+        auto links = course_departments.find(course_id);
+        if (dept == department_index.end() || links == course_departments.end()) return;
+        auto& depts = links->second;
+        auto it = find(depts.begin(), depts.end(), dept->second);
+        if (it == depts.end()) return;
+        depts.erase(it);
+        auto course = by_course.find(course_id);
+        if (course != by_course.end()) {
+            by_department[dept->second].sum -= course->second.sum;
+            by_department[dept->second].count -= course->second.count;
+        }
+    }
+
+    WAMAggregate course(SymbolId course_id) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = by_course.find(course_id);
+        return it != by_course.end() ? it->second : WAMAggregate{};
+    }
+
+    WAMAggregate department(const string& name) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = department_index.find(name);
+        return it != department_index.end() ? by_department[it->second] : WAMAggregate{};
+    }
+
+    map<string, WAMAggregate> departments() const {
+        lock_guard<mutex> lock(mtx);
+        map<string, WAMAggregate> result;
+        for (size_t i = 0; i < department_names.size(); ++i) {
+            result[department_names[i]] = by_department[i];
+        }
+        return result;
+    }
+};
+
+// --------------------------
+// Leaderboards
+// --------------------------
+
+// Order-statistics index over scores in [0, 100]. A Fenwick tree counts
+// entries per 0.01-wide bucket (highest bucket first), and each bucket keeps
+// its members so ties within a bucket are resolved on the exact score.
+// rank() is O(log B + bucket size); top(k) is O(k log B) plus bucket sorts.
+class ScoreIndex {
+    static constexpr int BUCKETS = 10001;
+
+    vector<uint32_t> tree;                          // 1-based Fenwick counts
+    vector<vector<pair<SymbolId, float>>> buckets;  // bucket -> members
+    size_t total = 0;
+
+    static int bucketOf(float score) {
+        int b = static_cast<int>(lround(clamp(score, 0.0f, 100.0f) * 100.0f));
+        return BUCKETS - 1 - b; // 0 is the best bucket
+    }
+
+    void add(int bucket, int delta) {
+        for (int i = bucket + 1; i <= BUCKETS; i += i & -i) tree[i] += delta;
+    }
+
+    // Entries in buckets [0, bucket)
+    size_t before(int bucket) const {
+        size_t n = 0;
+        for (int i = bucket; i > 0; i -= i & -i) n += tree[i];
+        return n;
+    }
+
+    // Smallest bucket whose prefix count reaches target (1-based)
+    int findBucket(size_t target) const {
+        int pos = 0;
+        for (int step = 1 << 13; step > 0; step >>= 1) {
+            if (pos + step <= BUCKETS && tree[pos + step] < target) {
+                pos += step;
+                target -= tree[pos];
+            }
+        }
+        return pos;
+    }
+
+    static bool better(const pair<SymbolId, float>& a, const pair<SymbolId, float>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    }
+
+public:
+    ScoreIndex() : tree(BUCKETS + 1, 0), buckets(BUCKETS) {}
+
+    void insert(SymbolId id, float score) {
+        int b = bucketOf(score);
+        buckets[b].emplace_back(id, score);
+        add(b, 1);
+        total++;
+    }
+
+    void erase(SymbolId id, float score) {
+        int b = bucketOf(score);
+        auto& members = buckets[b];
+        auto it = find_if(members.begin(), members.end(), [id](const auto& m) { return m.first == id; });
+        if (it == members.end()) return;
+        *it = members.back();
+        members.pop_back();
+        add(b, -1);
+        total--;
+    }
+
+    void move(SymbolId id, float old_score, float new_score) {
+        erase(id, old_score);
+        insert(id, new_score);
+    }
+
+    size_t rank(SymbolId id, float score) const {
+        int b = bucketOf(score);
+        pair<SymbolId, float> self{id, score};
+        size_t ahead = 0;
+        for (const auto& m : buckets[b]) {
+            if (better(m, self)) ahead++;
+        }
+        return before(b) + ahead + 1;
+    }
+
+    vector<pair<SymbolId, float>> top(size_t k) const {
+        vector<pair<SymbolId, float>> result;
+        k = min(k, total);
+        result.reserve(k);
+        while (result.size() < k) {
+            const auto& members = buckets[findBucket(result.size() + 1)];
+            size_t start = result.size();
+            result.insert(result.end(), members.begin(), members.end());
+            sort(result.begin() + start, result.end(), better);
+        }
+        result.resize(k);
+        return result;
+    }
+
+    size_t size() const { return total; }
+};
+
+// Live top-K and rank queries overall, per grade level and per course. Fed by
+// WAM change events; overall WAM per student is tracked incrementally.
+class Leaderboard : public Observer {
+    struct Entry {
+        WAMAggregate wam;
+        GradeLevel level;
+    };
+
+    unordered_map<SymbolId, Entry> entries;
+    ScoreIndex overall;
+    array<ScoreIndex, 4> by_level;
+    // Courses hold ~capacity students, so a sorted vector beats a ScoreIndex
+    unordered_map<SymbolId, vector<pair<SymbolId, float>>> by_course;
+    mutable mutex mtx;
+
+    static bool better(const pair<SymbolId, float>& a, const pair<SymbolId, float>& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    }
+
+    // Caller must hold mtx
+    void setCourseScore(SymbolId course_id, SymbolId student_id, optional<float> old_wam, float new_wam) {
+        if (old_wam) eraseCourseScore(course_id, student_id, *old_wam);
+        auto& ranked = by_course[course_id];
+        pair<SymbolId, float> entry{student_id, new_wam};
+        ranked.insert(lower_bound(ranked.begin(), ranked.end(), entry, better), entry);
+    }
+
+    void eraseCourseScore(SymbolId course_id, SymbolId student_id, float wam) {
+        auto& ranked = by_course[course_id];
+        auto it = lower_bound(ranked.begin(), ranked.end(), pair{student_id, wam}, better);
+        if (it != ranked.end() && it->first == student_id) ranked.erase(it);
+    }
+
+    static vector<pair<SymbolId, float>> head(const vector<pair<SymbolId, float>>& ranked, size_t k) {
+        return {ranked.begin(), ranked.begin() + min(k, ranked.size())};
+    }
+
+public:
+    void addStudent(const Student& student) {
+        lock_guard<mutex> lock(mtx);
+        Entry entry{{}, student.getGradeLevel()};
+        for (const auto& [course_id, wam] : student.getCourses()) {
+            if (!wam) continue;
+            entry.wam.apply(nullopt, *wam);
+            setCourseScore(course_id, student.getHandle(), nullopt, *wam);
+        }
+        float score = entry.wam.mean();
+        if (entries.try_emplace(student.getHandle(), entry).second) {
+            overall.insert(student.getHandle(), score);
+            by_level[static_cast<int>(entry.level)].insert(student.getHandle(), score);
+        }
+    }
+
+    void update(SymbolId student_id, SymbolId course_id, optional<float> old_wam, float new_wam) override {
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(student_id);
+        if (it == entries.end()) return;
+        auto& entry = it->second;
+        float before = entry.wam.mean();
+        entry.wam.apply(old_wam, new_wam);
+        float after = entry.wam.mean();
+        overall.move(student_id, before, after);
+        by_level[static_cast<int>(entry.level)].move(student_id, before, after);
+        setCourseScore(course_id, student_id, old_wam, new_wam);
+    }
+
+    void removeStudent(SymbolId student_id, const CourseScores& courses) {
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(student_id);
+        if (it == entries.end()) return;
+        float score = it->second.wam.mean();
+        overall.erase(student_id, score);
+        by_level[static_cast<int>(it->second.level)].erase(student_id, score);
+        entries.erase(it);
+        for (const auto& [course_id, wam] : courses) {
+            if (wam) eraseCourseScore(course_id, student_id, *wam);
+        }
+    }
+
+    void dropped(SymbolId student_id, SymbolId course_id, optional<float> wam) override {
+        if (!wam) return;
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(student_id);
+        if (it == entries.end()) return;
+        auto& entry = it->second;
+        float before = entry.wam.mean();
+        entry.wam.retract(*wam);
+        float after = entry.wam.mean();
+        overall.move(student_id, before, after);
+        by_level[static_cast<int>(entry.level)].move(student_id, before, after);
+        eraseCourseScore(course_id, student_id, *wam);
+    }
+
+    void setGradeLevel(SymbolId student_id, GradeLevel level) {
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(student_id);
+        if (it == entries.end() || it->second.level == level) return;
+        float score = it->second.wam.mean();
+        by_level[static_cast<int>(it->second.level)].erase(student_id, score);
+        by_level[static_cast<int>(level)].insert(student_id, score);
+        it->second.level = level;
+    }
+
+    vector<pair<SymbolId, float>> top(size_t k) const {
+        lock_guard<mutex> lock(mtx);
+        return overall.top(k);
+    }
+
+    vector<pair<SymbolId, float>> topInGradeLevel(GradeLevel level, size_t k) const {
+        lock_guard<mutex> lock(mtx);
+        return by_level[static_cast<int>(level)].top(k);
+    }
+
+    vector<pair<SymbolId, float>> topInCourse(SymbolId course_id, size_t k) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = by_course.find(course_id);
+        return it != by_course.end() ? head(it->second, k) : vector<pair<SymbolId, float>>{};
+    }
+
+    optional<size_t> rank(SymbolId student_id) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(student_id);
+        if (it == entries.end()) return nullopt;
+        return overall.rank(student_id, it->second.wam.mean());
+    }
+
+    optional<size_t> rankInCourse(SymbolId student_id, SymbolId course_id) const {
+        lock_guard<mutex> lock(mtx);
+        auto course = by_course.find(course_id);
+        if (course == by_course.end()) return nullopt;
+        const auto& ranked = course->second;
+        auto it = find_if(ranked.begin(), ranked.end(), [student_id](const auto& e) { return e.first == student_id; });
+        if (it == ranked.end()) return nullopt;
+        return size_t(it - ranked.begin()) + 1;
+    }
+};
+
+// --------------------------
+// Work-Stealing Thread Pool
+// --------------------------
+
+// Fixed set of workers, each with its own deque. Workers pop their own queue
+// LIFO and steal FIFO from the others; external submits are spread round-robin.
+class ThreadPool {
+    struct Queue {
+        deque<function<void()>> tasks;
+        mutex mtx;
+    };
+
+    vector<unique_ptr<Queue>> queues;
+    vector<thread> workers;
+    atomic<size_t> next_queue{0};
+    atomic<size_t> pending{0};
+    atomic<bool> stopping{false};
+    mutex sleep_mtx;
+    condition_variable wake;
+
+    static size_t& workerIndex() {
+        static thread_local size_t index = SIZE_MAX;
+        return index;
+    }
+
+    bool tryRun(size_t self) {
+        function<void()> task;
+        for (size_t i = 0; i < queues.size() && !task; ++i) {
+            size_t q = (self + i) % queues.size();
+            lock_guard<mutex> lock(queues[q]->mtx);
+            auto& tasks = queues[q]->tasks;
+            if (tasks.empty()) continue;
+            if (q == self) {
+                task = move(tasks.back());
+                tasks.pop_back();
+            } else {
+                task = move(tasks.front());
+                tasks.pop_front();
+            }
+        }
+        if (!task) return false;
+        pending--;
+        task();
+        return true;
+    }
+
+    void workerLoop(size_t self) {
+        workerIndex() = self;
+        while (true) {
+            if (tryRun(self)) continue;
+            unique_lock<mutex> lock(sleep_mtx);
+            wake.wait(lock, [this] { return stopping || pending > 0; });
+            if (stopping && pending == 0) return;
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t threads = thread::hardware_concurrency()) {
+        threads = max<size_t>(threads, 1);
+        for (size_t i = 0; i < threads; ++i) queues.push_back(make_unique<Queue>());
+        for (size_t i = 0; i < threads; ++i) workers.emplace_back([this, i] { workerLoop(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(sleep_mtx);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(function<void()> task) {
+        size_t self = workerIndex();
+        size_t q = self < queues.size() ? self : next_queue++ % queues.size();
+        {
+            // Count first so a worker that pops the task never sees pending wrap
+            lock_guard<mutex> lock(sleep_mtx);
+            pending++;
+        }
+        {
+            lock_guard<mutex> lock(queues[q]->mtx);
+            queues[q]->tasks.push_back(move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Runs body(begin, end) over [0, n) in chunks of at most `chunk` items and
+    // waits for all of them. The caller helps drain the queues while waiting,
+    // so nested calls from inside a task cannot deadlock the pool.
+    template <typename Body>
+    void parallelFor(size_t n, size_t chunk, Body body) {
+        if (n == 0) return;
+        chunk = max<size_t>(chunk, 1);
+        size_t tasks = (n + chunk - 1) / chunk;
+        atomic<size_t> remaining{tasks};
+        mutex error_mtx;
+        exception_ptr error;
+
+        for (size_t t = 0; t < tasks; ++t) {
+            size_t begin = t * chunk, end = min(n, begin + chunk);
+            submit([&, begin, end] {
+                try {
+                    body(begin, end);
+                } catch (...) {
+                    lock_guard<mutex> lock(error_mtx);
+                    if (!error) error = current_exception();
+                }
+                remaining--;
+            });
+        }
+
+        size_t self = workerIndex() < queues.size() ? workerIndex() : 0;
+        while (remaining > 0) {
+            if (!tryRun(self)) this_thread::yield();
+        }
+        if (error) rethrow_exception(error);
+    }
+
+    size_t size() const { return workers.size(); }
+};
+
+ThreadPool& defaultPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// --------------------------
+// Report Formatting
+// --------------------------
+
+// Fixed-point formatting without iostreams
+inline void appendFixed(string& out, double value, int precision) {
+    char buf[32];
+    auto res = to_chars(buf, buf + sizeof(buf), value, chars_format::fixed, precision);
+    out.append(buf, res.ptr);
+}
+
+enum class ReportFormat { Plain, Color, Json, Csv };
+
+inline void appendJsonString(string& out, string_view str) {
+    out += '"';
+    for (char c : str) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+inline void appendInt(string& out, long long value) {
+    char buf[24];
+    auto res = to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+
+// Quotes only when the field needs it (RFC 4180)
+inline void appendCsvField(string& out, string_view str) {
+    if (str.find_first_of(",\"\n\r") == string_view::npos) {
+        out += str;
+        return;
+    }
+    out += '"';
+    for (char c : str) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// One JSON object per line, so dumps can be streamed and split
+void appendStudentReportJson(string& out, const Student& student) {
+    out += "{\"id\":";
+    appendJsonString(out, student.getId());
+    out += ",\"name\":";
+    appendJsonString(out, student.getName());
+    out += ",\"grade_level\":\"";
+    out += gradeLevelToString(student.getGradeLevel());
+    out += "\",\"overall_wam\":";
+    appendFixed(out, student.overallWAM(), 1);
+    out += ",\"courses\":[";
+    bool first = true;
+    for (const auto& [course_id, wam] : student.copyCourses()) {
+        if (!first) out += ',';
+        first = false;
+        out += "{\"id\":";
+        appendJsonString(out, symbols().name(course_id));
+        out += ",\"wam\":";
+        if (wam.has_value()) {
+            appendFixed(out, wam.value(), 1);
+        } else {
+            out += "null";
+        }
+        out += '}';
+    }
+    out += "]}\n";
+}
+
+// One row per student; courses packed as "id:wam;id:wam", ungraded as "id:"
+void appendStudentReportCsv(string& out, const Student& student) {
+    appendCsvField(out, student.getId());
+    out += ',';
+    appendCsvField(out, student.getName());
+    out += ',';
+    out += gradeLevelToString(student.getGradeLevel());
+    out += ',';
+    appendFixed(out, student.overallWAM(), 1);
+    out += ',';
+    bool first = true;
+    for (const auto& [course_id, wam] : student.copyCourses()) {
+        if (!first) out += ';';
+        first = false;
+        out += symbols().name(course_id);
+        out += ':';
+        if (wam.has_value()) appendFixed(out, wam.value(), 1);
+    }
+    out += '\n';
+}
+
+// Appends the report block for one student to out. Courses are read from a
+// locked copy, so reports can run alongside enrollments.
+void appendStudentReport(string& out, const Student& student, ReportFormat format = ReportFormat::Plain) {
+    if (format == ReportFormat::Json) {
+        appendStudentReportJson(out, student);
+        return;
+    }
+    if (format == ReportFormat::Csv) {
+        appendStudentReportCsv(out, student);
+        return;
+    }
+    bool color = format == ReportFormat::Color;
+    if (color) out += BOLD BLUE;
+    out += "Student Report for ";
+    out += student.getName();
+    out += " (";
+    out += student.getId();
+    out += ")";
+    if (color) out += RESET;
+    out += "\nGrade Level: ";
+    out += gradeLevelToString(student.getGradeLevel());
+    out += "\nOverall WAM: ";
+    if (color) out += CYAN;
+    appendFixed(out, student.overallWAM(), 1);
+    if (color) out += RESET;
+    out += "\nCourses:\n";
+    for (const auto& [course_id, wam] : student.copyCourses()) {
+        out += " - ";
+        out += symbols().name(course_id);
+        out += ": ";
+        if (wam.has_value()) {
+            appendFixed(out, wam.value(), 1);
+        } else {
+            if (color) out += YELLOW;
+            out += "No grade yet";
+            if (color) out += RESET;
+        }
+        out += "\n";
+    }
+}
+
+// --------------------------
+// Report Sinks
+// --------------------------
+
+// Destination for streamed reports. write() receives a batch of buffers that
+// stay valid only for the duration of the call.
+class ReportSink {
+public:
+    virtual ~ReportSink() = default;
+    virtual void write(span<const string_view> buffers) = 0;
+};
+
+// Writes with writev, looping over short writes and IOV_MAX-sized groups
+class FdReportSink : public ReportSink {
+    int fd;
+
+public:
+    explicit FdReportSink(int fd) : fd(fd) {}
+
+    void write(span<const string_view> buffers) override {
+        vector<iovec> iov;
+        iov.reserve(buffers.size());
+        for (string_view b : buffers) {
+            if (!b.empty()) iov.push_back({const_cast<char*>(b.data()), b.size()});
+        }
+        size_t i = 0;
+        while (i < iov.size()) {
+            int count = static_cast<int>(min<size_t>(iov.size() - i, IOV_MAX));
+            ssize_t n = ::writev(fd, iov.data() + i, count);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error(string("Report write failed: ") + strerror(errno));
+            }
+            // Skip fully written buffers, trim the partially written one
+            size_t written = n;
+            while (i < iov.size() && written >= iov[i].iov_len) written -= iov[i++].iov_len;
+            if (i < iov.size()) {
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + written;
+                iov[i].iov_len -= written;
+            }
+        }
+    }
+};
+
+class OstreamReportSink : public ReportSink {
+    ostream& out;
+
+public:
+    explicit OstreamReportSink(ostream& out) : out(out) {}
+
+    void write(span<const string_view> buffers) override {
+        for (string_view b : buffers) out.write(b.data(), b.size());
+        if (!out) throw runtime_error("Report write failed");
+    }
+};
+
+class CallbackReportSink : public ReportSink {
+    function<void(string_view)> callback;
+
+public:
+    explicit CallbackReportSink(function<void(string_view)> callback) : callback(move(callback)) {}
+
+    void write(span<const string_view> buffers) override {
+        for (string_view b : buffers) callback(b);
+    }
+};
+
+// --------------------------
+// Batch Enrollment Results
+// --------------------------
+
+struct BatchEnrollResult {
+    vector<EnrollStatus> statuses; // one per input row, in input order
+    size_t enrolled = 0;
+    nanoseconds elapsed{0};
+
+    size_t count(EnrollStatus status) const {
+        return std::count(statuses.begin(), statuses.end(), status);
+    }
+
+    double rowsPerSecond() const {
+        double secs = duration<double>(elapsed).count();
+        return secs > 0 ? statuses.size() / secs : 0.0;
+    }
+};
+
+// --------------------------
+// Load Generation
+// --------------------------
+
+enum class LoadDistribution { UNIFORM, ZIPF };
+
+struct LoadConfig {
+    size_t producers = 1;
+    size_t updates_per_producer = 100000;
+    double target_rate = 0;           // total updates/s; 0 runs unthrottled
+    uint64_t seed = 42;               // same seed, same update sequence per producer
+    LoadDistribution student_distribution = LoadDistribution::UNIFORM;
+    LoadDistribution course_distribution = LoadDistribution::UNIFORM;
+    double zipf_skew = 1.0;
+    float min_wam = 50.0f;
+    float max_wam = 95.0f;
+    size_t sync_every = 1024;         // updates between visibility samples; 0 disables
+};
+
+struct LatencySummary {
+    size_t samples = 0;
+    nanoseconds p50{0}, p99{0}, p999{0}, max{0};
+
+    // Consumes the samples
+    static LatencySummary from(vector<nanoseconds>& samples) {
+        LatencySummary summary;
+        summary.samples = samples.size();
+        if (samples.empty()) return summary;
+        auto at = [&](double q) {
+            size_t k = min(samples.size() - 1, static_cast<size_t>(q * samples.size()));
+            nth_element(samples.begin(), samples.begin() + k, samples.end());
+            return samples[k];
+        };
+        summary.p50 = at(0.50);
+        summary.p99 = at(0.99);
+        summary.p999 = at(0.999);
+        summary.max = *max_element(samples.begin(), samples.end());
+        return summary;
+    }
+};
+
+struct LoadReport {
+    size_t updates = 0;
+    nanoseconds elapsed{0};
+    LatencySummary update_latency;     // updateWAM call, measured from its scheduled start
+    LatencySummary visibility_latency; // waiting for observers to drain the event bus
+
+    double updatesPerSecond() const {
+        double secs = duration<double>(elapsed).count();
+        return secs > 0 ? updates / secs : 0.0;
+    }
+};
+
+// Index sampler over [0, n): uniform, or Zipf via a precomputed CDF
+class IndexSampler {
+    LoadDistribution distribution;
+    size_t n;
+    vector<double> cdf;
+
+public:
+    IndexSampler(LoadDistribution distribution, size_t n, double skew)
+        : distribution(distribution), n(n) {
+        if (distribution != LoadDistribution::ZIPF || n == 0) return;
+        cdf.resize(n);
+        double total = 0;
+        for (size_t i = 0; i < n; ++i) cdf[i] = total += 1.0 / pow(double(i + 1), skew);
+        for (double& c : cdf) c /= total;
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) const {
+        if (distribution == LoadDistribution::UNIFORM) return uniform_int_distribution<size_t>(0, n - 1)(rng);
+        double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+        return min(n - 1, static_cast<size_t>(lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin()));
+    }
+};
+
+// --------------------------
+// Course Assignment Rules
+// --------------------------
+
+struct CourseRule {
+    Specialization specialization;
+    string_view course_id;
+};
+
+// What main used to hard-code: one intro course per teaching specialization
+constexpr array<CourseRule, 4> DEFAULT_COURSE_RULES = {{
+    {Specialization::PROGRAMMING_PARADIGMS, "CS101"},
+    {Specialization::NETWORK_AND_COMMUNICATION, "CS201"},
+    {Specialization::BACKEND_DEVELOPMENT, "CS301"},
+    {Specialization::CAREER_SKILLS, "PD101"},
+}};
+
+// Rules compiled into a flat specialization -> course handles lookup
+// (offsets into one array), so applying them is an index per teacher
+class CourseAssignmentRules {
+    array<uint32_t, SPECIALIZATION_COUNT + 1> offsets{};
+    vector<SymbolId> courses;
+
+public:
+    explicit CourseAssignmentRules(span<const CourseRule> rules = DEFAULT_COURSE_RULES) {
+        for (const auto& rule : rules) offsets[static_cast<size_t>(rule.specialization) + 1]++;
+        for (size_t i = 1; i < offsets.size(); ++i) offsets[i] += offsets[i - 1];
+        courses.resize(rules.size());
+        auto fill = offsets;
+        for (const auto& rule : rules) {
+            courses[fill[static_cast<size_t>(rule.specialization)]++] = symbols().intern(rule.course_id);
+        }
+    }
+
+    span<const SymbolId> coursesFor(Specialization specialization) const {
+        size_t i = static_cast<size_t>(specialization);
+        return span<const SymbolId>(courses).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+// --------------------------
+// Prerequisite Graph
+// --------------------------
+
+// Immutable prerequisite DAG over every offered course plus any course named
+// only as a prerequisite. Built once; construction rejects cycles and
+// precomputes, per course, a bitset of all transitive prerequisites, so an
+// eligibility check is a word-wise AND-NOT against the student's passed set.
+class PrerequisiteGraph {
+    vector<SymbolId> nodes;     // dense index -> course handle
+    vector<int32_t> index_of;   // course handle -> dense index, -1 if none
+    size_t words = 0;
+    vector<uint64_t> closure;   // nodes.size() rows of `words` words
+
+    const uint64_t* row(size_t node) const { return closure.data() + node * words; }
+
+public:
+    static constexpr float PASS_MARK = 50.0f;
+
+    explicit PrerequisiteGraph(const vector<shared_ptr<Course>>& courses) {
+        index_of.assign(symbols().size(), -1);
+        auto node = [&](SymbolId handle) {
+            if (handle >= index_of.size()) index_of.resize(handle + 1, -1);
+            if (index_of[handle] < 0) {
+                index_of[handle] = static_cast<int32_t>(nodes.size());
+                nodes.push_back(handle);
+            }
+            return static_cast<uint32_t>(index_of[handle]);
+        };
+
+        vector<pair<uint32_t, uint32_t>> edges; // (course, prerequisite)
+        for (const auto& course : courses) {
+            uint32_t c = node(course->getHandle());
+            for (SymbolId p : course->getPrerequisites()) edges.emplace_back(c, node(p));
+        }
+
+        // Kahn's algorithm: a course is ready once all its prerequisites are
+        vector<uint32_t> pending(nodes.size(), 0);
+        vector<vector<uint32_t>> dependents(nodes.size());
+        for (const auto& [c, p] : edges) {
+            pending[c]++;
+            dependents[p].push_back(c);
+        }
+        vector<uint32_t> order;
+        order.reserve(nodes.size());
+        for (uint32_t n = 0; n < nodes.size(); ++n) {
+            if (pending[n] == 0) order.push_back(n);
+        }
+        for (size_t i = 0; i < order.size(); ++i) {
+            for (uint32_t d : dependents[order[i]]) {
+                if (--pending[d] == 0) order.push_back(d);
+            }
+        }
+        if (order.size() != nodes.size()) {
+            string cycle;
+            for (uint32_t n = 0; n < nodes.size(); ++n) {
+                if (pending[n] > 0) cycle += (cycle.empty() ? "" : ", ") + symbols().name(nodes[n]);
+            }
+            throw runtime_error("Prerequisite cycle involving: " + cycle);
+        }
+
+        vector<vector<uint32_t>> prereqs(nodes.size());
+        for (const auto& [c, p] : edges) prereqs[c].push_back(p);
+        words = (nodes.size() + 63) / 64;
+        closure.assign(nodes.size() * words, 0);
+        for (uint32_t c : order) {
+            uint64_t* dst = closure.data() + c * words;
+            for (uint32_t p : prereqs[c]) {
+                dst[p / 64] |= uint64_t(1) << (p % 64);
+                const uint64_t* src = row(p);
+                for (size_t w = 0; w < words; ++w) dst[w] |= src[w];
+            }
+        }
+    }
+
+    int32_t indexOf(SymbolId course_id) const {
+        return course_id < index_of.size() ? index_of[course_id] : -1;
+    }
+
+    // Bitset of the student's passed courses in this graph's numbering
+    void passedBits(const Student& student, vector<uint64_t>& bits) const {
+        bits.assign(words, 0);
+        for (SymbolId c : student.passedCourses(PASS_MARK)) {
+            int32_t n = indexOf(c);
+            if (n >= 0) bits[n / 64] |= uint64_t(1) << (n % 64);
+        }
+    }
+
+    // True if every transitive prerequisite of course_id is set in passed
+    bool satisfied(SymbolId course_id, const vector<uint64_t>& passed) const {
+        int32_t n = indexOf(course_id);
+        if (n < 0) return true;
+        const uint64_t* need = row(n);
+        for (size_t w = 0; w < words; ++w) {
+            if (need[w] & ~passed[w]) return false;
+        }
+        return true;
+    }
+
+    bool canEnroll(const Student& student, SymbolId course_id) const {
+        int32_t n = indexOf(course_id);
+        if (n < 0 || all_of(row(n), row(n) + words, [](uint64_t w) { return w == 0; })) return true;
+        vector<uint64_t> passed;
+        passedBits(student, passed);
+        return satisfied(course_id, passed);
+    }
+
+    // Transitive prerequisites of course_id
+    vector<SymbolId> prerequisitesOf(SymbolId course_id) const {
+        vector<SymbolId> result;
+        int32_t n = indexOf(course_id);
+        if (n < 0) return result;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (row(n)[i / 64] & (uint64_t(1) << (i % 64))) result.push_back(nodes[i]);
+        }
+        return result;
+    }
+
+    // For each student in cohort, the offered courses they are not yet
+    // enrolled in whose prerequisites they have all passed. Runs on the pool.
+    vector<vector<SymbolId>> eligibleCourses(span<const Student* const> cohort,
+                                             const vector<shared_ptr<Course>>& offered) const {
+        vector<vector<SymbolId>> result(cohort.size());
+        defaultPool().parallelFor(cohort.size(), 256, [&](size_t begin, size_t end) {
+            vector<uint64_t> passed;
+            for (size_t i = begin; i < end; ++i) {
+                passedBits(*cohort[i], passed);
+                for (const auto& course : offered) {
+                    SymbolId c = course->getHandle();
+                    if (!cohort[i]->isEnrolledIn(c) && satisfied(c, passed)) result[i].push_back(c);
+                }
+            }
+        });
+        return result;
+    }
+
+    size_t size() const { return nodes.size(); }
+};
+
+// --------------------------
+// Seat Allocation
+// --------------------------
+
+struct SeatPreferences {
+    string student_id;
+    vector<string> courses; // most wanted first
+};
+
+struct AllocationOptions {
+    size_t max_courses = 4; // new seats per student
+    uint64_t seed = 0;      // lottery order within a grade level
+};
+
+struct AllocationResult {
+    vector<vector<SymbolId>> placements; // per request, seated courses in preference order
+    size_t requested = 0;                // preference entries across all requests
+    size_t placed = 0;
+    size_t not_found = 0;                // unknown student or course
+    size_t duplicate = 0;                // already enrolled, or listed twice
+    size_t prereq_missing = 0;
+    size_t lost = 0;                     // allocated, then taken by a concurrent enrollment
+    size_t rounds = 0;
+    nanoseconds solve_elapsed{0};        // resolving and matching
+    nanoseconds commit_elapsed{0};       // the enrollment batch
+};
+
+struct SeatApplicant {
+    Student* student = nullptr;
+    vector<uint32_t> courses; // dense course indexes, most wanted first
+    uint64_t priority = 0;    // higher wins a contested seat
+};
+
+struct SeatHolder {
+    uint32_t applicant;
+    uint32_t rank; // position in the applicant's list
+};
+
+struct SeatSolution {
+    vector<vector<SeatHolder>> holders; // per dense course, unordered
+    size_t rounds = 0;
+};
+
+// Seniority first; a seeded hash orders students within a grade level
+uint64_t allocationPriority(const Student& student, uint64_t seed) {
+    uint64_t h = (uint64_t(student.getHandle()) + 1) * 0x9e3779b97f4a7c15ull ^ seed;
+    h ^= h >> 31;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 29;
+    return (uint64_t(student.getGradeLevel()) << 56) | (h >> 8);
+}
+
+// Many-to-many deferred acceptance. Each round every applicant holding fewer
+// than max_courses seats proposes to its next preferences; each course keeps
+// its highest-priority proposers up to its free seats and rejects the rest,
+// who move further down their lists next round. An applicant proposes to a
+// course at most once, so this ends within (longest list) rounds, and no
+// applicant and course both prefer each other to what they ended up with.
+// Proposals and per-course decisions run on the pool.
+SeatSolution solveSeatAllocation(span<const SeatApplicant> applicants, span<const int> free_seats, size_t max_courses) {
+    constexpr size_t CHUNK = 1024;
+    const size_t course_count = free_seats.size();
+    SeatSolution solution;
+    solution.holders.resize(course_count);
+
+    auto outranks = [&](const SeatHolder& a, const SeatHolder& b) {
+        uint64_t pa = applicants[a.applicant].priority, pb = applicants[b.applicant].priority;
+        return pa != pb ? pa > pb : a.applicant < b.applicant;
+    };
+
+    vector<uint32_t> next(applicants.size(), 0), held(applicants.size(), 0);
+    vector<uint32_t> active(applicants.size());
+    iota(active.begin(), active.end(), 0);
+    vector<vector<pair<uint32_t, SeatHolder>>> emitted;
+    vector<size_t> offsets(course_count + 1);
+    vector<SeatHolder> proposals;
+    vector<vector<uint32_t>> rejected(course_count);
+    vector<uint8_t> queued(applicants.size(), 0);
+
+    while (!active.empty()) {
+        solution.rounds++;
+        emitted.assign((active.size() + CHUNK - 1) / CHUNK, {});
+        defaultPool().parallelFor(active.size(), CHUNK, [&](size_t begin, size_t end) {
+            auto& out = emitted[begin / CHUNK];
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t a = active[i];
+                const auto& list = applicants[a].courses;
+                for (; held[a] < max_courses && next[a] < list.size(); next[a]++, held[a]++) {
+                    out.emplace_back(list[next[a]], SeatHolder{a, next[a]});
+                }
+            }
+        });
+
+        // Counting sort of this round's proposals by course
+        fill(offsets.begin(), offsets.end(), 0);
+        for (const auto& out : emitted) {
+            for (const auto& [c, _] : out) offsets[c + 1]++;
+        }
+        partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        proposals.resize(offsets.back());
+        vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (const auto& out : emitted) {
+            for (const auto& [c, holder] : out) proposals[cursor[c]++] = holder;
+        }
+
+        defaultPool().parallelFor(course_count, 64, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                rejected[c].clear();
+                if (offsets[c] == offsets[c + 1]) continue;
+                auto& keep = solution.holders[c];
+                keep.insert(keep.end(), proposals.begin() + offsets[c], proposals.begin() + offsets[c + 1]);
+                size_t seats = size_t(max(free_seats[c], 0));
+                if (keep.size() <= seats) continue;
+                nth_element(keep.begin(), keep.begin() + seats, keep.end(), outranks);
+                for (auto it = keep.begin() + seats; it != keep.end(); ++it) rejected[c].push_back(it->applicant);
+                keep.resize(seats);
+            }
+        });
+
+        // Only rejected applicants have anything left to propose
+        active.clear();
+        for (const auto& list : rejected) {
+            for (uint32_t a : list) {
+                held[a]--;
+                if (!queued[a] && next[a] < applicants[a].courses.size()) {
+                    queued[a] = 1;
+                    active.push_back(a);
+                }
+            }
+        }
+        for (uint32_t a : active) queued[a] = 0;
+    }
+    return solution;
+}
+
+// --------------------------
+// Concurrent Directory
+// --------------------------
+
+// Id -> (slot, entity) table with lock-free lookups. Writers must be
+// serialized by the caller. Each entry is published with a release store of
+// `ready`. Growing builds a new table and swaps the pointer; the old one is
+// handed out by takeRetired for the caller to free once no reader can still
+// be probing it (College ties that to its views). Erasing drops the entity
+// and leaves a tombstone that lookups skip, removed on the next grow.
+template <typename T>
+class ConcurrentDirectory {
+    struct Entry {
+        atomic<bool> ready{false};
+        atomic<bool> erased{false};
+        string_view key;
+        atomic<size_t> slot{0};
+        T* raw = nullptr;             // for findRaw, set with item
+        atomic<shared_ptr<T>> item;   // null once erased
+    };
+
+    struct Table {
+        unique_ptr<Entry[]> entries;
+        size_t mask;
+        explicit Table(size_t n) : entries(new Entry[n]), mask(n - 1) {}
+    };
+
+    atomic<Table*> current{nullptr};
+    unique_ptr<Table> table;               // owns current
+    vector<shared_ptr<const void>> retired; // replaced tables, until takeRetired
+    size_t count = 0;
+
+    static size_t hashKey(string_view key) {
+        size_t h = 1469598103934665603ULL;
+        for (unsigned char c : key) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    static void place(Table& table, string_view key, size_t slot, shared_ptr<T> item) {
+        for (size_t i = hashKey(key) & table.mask;; i = (i + 1) & table.mask) {
+            Entry& e = table.entries[i];
+            if (!e.ready.load(memory_order_relaxed)) {
+                e.key = key;
+                e.slot.store(slot, memory_order_relaxed);
+                e.raw = item.get();
+                e.item.store(move(item), memory_order_relaxed);
+                e.ready.store(true, memory_order_release);
+                return;
+            }
+        }
+    }
+
+    const Entry* findEntry(string_view key) const {
+        const Table* table = current.load(memory_order_acquire);
+        if (!table) return nullptr;
+        for (size_t i = hashKey(key) & table->mask;; i = (i + 1) & table->mask) {
+            const Entry& e = table->entries[i];
+            if (!e.ready.load(memory_order_acquire)) return nullptr;
+            if (e.key == key && !e.erased.load(memory_order_acquire)) return &e;
+        }
+    }
+
+public:
+    void reserve(size_t n) {
+        Table* old = current.load(memory_order_relaxed);
+        size_t size = old ? old->mask + 1 : 0;
+        if (n * 4 <= size * 3) return;
+        size_t new_size = max<size_t>(size, 16);
+        while (n * 4 > new_size * 3) new_size *= 2;
+
+        auto next = make_unique<Table>(new_size);
+        count = 0;
+        for (size_t i = 0; old && i <= old->mask; ++i) {
+            const Entry& e = old->entries[i];
+            if (e.ready.load(memory_order_relaxed) && !e.erased.load(memory_order_relaxed)) {
+                place(*next, e.key, e.slot.load(memory_order_relaxed), e.item.load(memory_order_relaxed));
+                count++;
+            }
+        }
+        current.store(next.get(), memory_order_release);
+        if (table) retired.push_back(move(table));
+        table = move(next);
+    }
+
+    // Tables replaced since the last call. Caller serializes writers.
+    vector<shared_ptr<const void>> takeRetired() {
+        return exchange(retired, {});
+    }
+
+    // Returns false if the key is already present. Caller serializes writers.
+    bool insert(string_view key, size_t slot, shared_ptr<T> item) {
+        if (findEntry(key)) return false;
+        reserve(count + 1);
+        place(*current.load(memory_order_relaxed), key, slot, move(item));
+        count++;
+        return true;
+    }
+
+    shared_ptr<T> find(string_view key) const {
+        const Entry* e = findEntry(key);
+        return e ? e->item.load(memory_order_acquire) : nullptr;
+    }
+
+    optional<size_t> findSlot(string_view key) const {
+        const Entry* e = findEntry(key);
+        return e ? optional<size_t>(e->slot.load(memory_order_relaxed)) : nullopt;
+    }
+
+    // Caller serializes writers
+    void setSlot(string_view key, size_t slot) {
+        if (const Entry* e = findEntry(key)) const_cast<Entry*>(e)->slot.store(slot, memory_order_relaxed);
+    }
+
+    // Returns the erased entity, or null if the key was absent; the directory
+    // keeps no reference to it. The key may be inserted again afterwards.
+    // Caller serializes writers.
+    shared_ptr<T> erase(string_view key) {
+        const Entry* e = findEntry(key);
+        if (!e) return nullptr;
+        auto& entry = const_cast<Entry&>(*e);
+        entry.erased.store(true, memory_order_release);
+        return entry.item.exchange(nullptr, memory_order_acq_rel);
+    }
+
+    // Lock-free and allocation-free. The pointer carries no reference: the
+    // caller keeps the entity alive, e.g. by holding a view that contains it.
+    T* findRaw(string_view key) const {
+        const Entry* e = findEntry(key);
+        return e ? e->raw : nullptr;
+    }
+};
+
+// --------------------------
+// Versioned Read Views
+// --------------------------
+
+// Append-only sequence whose versions share storage. Full segments are
+// immutable and shared by every later version, so publishing a version copies
+// only the segment table and the partly filled tail.
+template <typename T>
+class SegmentedList {
+    static constexpr size_t SEGMENT = 1024;
+    using Segment = vector<shared_ptr<T>>;
+
+    vector<shared_ptr<const Segment>> segments;
+    size_t count = 0;
+
+public:
+    class iterator {
+        const SegmentedList* list;
+        size_t i;
+
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = shared_ptr<T>;
+        using difference_type = ptrdiff_t;
+        using pointer = const shared_ptr<T>*;
+        using reference = const shared_ptr<T>&;
+
+        iterator(const SegmentedList* list, size_t i) : list(list), i(i) {}
+        reference operator*() const { return (*list)[i]; }
+        pointer operator->() const { return &(*list)[i]; }
+        iterator& operator++() { ++i; return *this; }
+        iterator operator++(int) { iterator old = *this; ++i; return old; }
+        bool operator==(const iterator& other) const { return i == other.i; }
+    };
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const shared_ptr<T>& operator[](size_t i) const { return (*segments[i / SEGMENT])[i % SEGMENT]; }
+    iterator begin() const { return {this, 0}; }
+    iterator end() const { return {this, count}; }
+
+    // A new version with items appended; this one is left untouched
+    SegmentedList appended(span<const shared_ptr<T>> items) const {
+        SegmentedList next = *this;
+        if (items.empty()) return next;
+        Segment tail;
+        if (count % SEGMENT) {
+            tail = *next.segments.back();
+            next.segments.pop_back();
+        }
+        tail.reserve(SEGMENT);
+        for (const auto& item : items) {
+            tail.push_back(item);
+            if (tail.size() == SEGMENT) {
+                next.segments.push_back(make_shared<const Segment>(move(tail)));
+                tail = Segment();
+                tail.reserve(SEGMENT);
+            }
+        }
+        if (!tail.empty()) next.segments.push_back(make_shared<const Segment>(move(tail)));
+        next.count += items.size();
+        return next;
+    }
+
+    // A new version with the items at `slots` removed, each hole filled by the
+    // current last item; moved(item, slot) reports every relocation. Copies the
+    // segment table plus the segments it writes, so cost tracks slots.size().
+    template <typename Moved>
+    SegmentedList swapRemoved(vector<size_t> slots, Moved moved) const {
+        SegmentedList next = *this;
+        unordered_map<size_t, shared_ptr<Segment>> owned; // segments private to next
+        auto writable = [&](size_t s) -> Segment& {
+            auto [it, inserted] = owned.try_emplace(s);
+            if (inserted) {
+                it->second = make_shared<Segment>(*next.segments[s]);
+                next.segments[s] = it->second;
+            }
+            return *it->second;
+        };
+
+        // Highest first, so the item pulled from the end is never one still
+        // waiting to be removed
+        sort(slots.begin(), slots.end(), greater<>());
+        slots.erase(unique(slots.begin(), slots.end()), slots.end());
+        for (size_t slot : slots) {
+            if (slot >= next.count) throw out_of_range("SegmentedList slot out of range");
+            size_t last = next.count - 1;
+            if (slot != last) {
+                shared_ptr<T> item = next[last];
+                writable(slot / SEGMENT)[slot % SEGMENT] = item;
+                moved(item, slot);
+            }
+            Segment& tail = writable(last / SEGMENT);
+            tail.pop_back();
+            if (tail.empty()) {
+                owned.erase(last / SEGMENT);
+                next.segments.pop_back();
+            }
+            next.count--;
+        }
+        return next;
+    }
+
+    vector<shared_ptr<T>> toVector() const {
+        vector<shared_ptr<T>> out;
+        out.reserve(count);
+        for (const auto& segment : segments) out.insert(out.end(), segment->begin(), segment->end());
+        return out;
+    }
+};
+
+// Memory retired while one view was current: replaced index tables and
+// superseded profiles that lock-free readers of that view or an older one may
+// still be using. Each epoch holds the next, so an epoch, its garbage and
+// every later epoch are freed once no view up to it is held.
+struct ViewEpoch {
+    vector<shared_ptr<const void>> retired;
+    shared_ptr<ViewEpoch> next; // set when the successor view is published
+
+    ViewEpoch() = default;
+    ViewEpoch(const ViewEpoch&) = delete;
+    ViewEpoch& operator=(const ViewEpoch&) = delete;
+
+    // Unlinks iteratively, since a long run of epochs can drain at once
+    ~ViewEpoch() {
+        shared_ptr<ViewEpoch> rest = move(next);
+        while (rest && rest.use_count() == 1) rest = move(rest->next);
+    }
+};
+
+// Immutable membership of a College at one version. Readers load the current
+// view with one atomic shared_ptr load and keep it as long as they like;
+// writers publish a successor under College::mtx. Entities themselves are
+// shared, so grades read through a view are live.
+struct CollegeView {
+    uint64_t version = 0;
+    SegmentedList<Student> students;
+    SegmentedList<Teacher> teachers;
+    SegmentedList<Course> courses;
+    shared_ptr<ViewEpoch> epoch = make_shared<ViewEpoch>();
+
+    // Handles in slot order, for lookups that must line up with students
+    vector<SymbolId> studentHandles() const {
+        vector<SymbolId> handles;
+        handles.reserve(students.size());
+        for (const auto& student : students) handles.push_back(student->getHandle());
+        return handles;
+    }
+};
+
+// --------------------------
+// Entity Store
+// --------------------------
+
+// Non-owning reference to an entity of any kind
+using EntityRef = variant<const Student*, const Teacher*, const Course*>;
+
+// Visitor assembled from lambdas: visitEntity(ref, Overloaded{...})
+template <typename... Fs>
+struct Overloaded : Fs... {
+    using Fs::operator()...;
+};
+template <typename... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+// One view's entities as flat, type-segregated pointer arrays for
+// full-population sweeps. A sweep walks each array linearly with no segment
+// arithmetic or reference counts, and the visitor's overload for each kind is
+// resolved at compile time, so per-entity work can be inlined. Entities are
+// live and not copyable, so they stay where they are; the store holds the view
+// that owns them.
+class EntityStore {
+    shared_ptr<const CollegeView> source;
+    vector<const Student*> students;
+    vector<const Teacher*> teachers;
+    vector<const Course*> courses;
+
+    template <typename T>
+    static vector<const T*> flatten(const SegmentedList<T>& list) {
+        vector<const T*> out;
+        out.reserve(list.size());
+        for (const auto& entity : list) out.push_back(entity.get());
+        return out;
+    }
+
+public:
+    explicit EntityStore(shared_ptr<const CollegeView> view)
+        : source(move(view)), students(flatten(source->students)),
+          teachers(flatten(source->teachers)), courses(flatten(source->courses)) {}
+
+    uint64_t version() const { return source->version; }
+    const CollegeView& view() const { return *source; }
+    span<const Student* const> getStudents() const { return students; }
+    span<const Teacher* const> getTeachers() const { return teachers; }
+    span<const Course* const> getCourses() const { return courses; }
+    size_t size() const { return students.size() + teachers.size() + courses.size(); }
+
+    // Students, then teachers, then courses
+    EntityRef operator[](size_t i) const {
+        if (i < students.size()) return students[i];
+        i -= students.size();
+        if (i < teachers.size()) return teachers[i];
+        return courses.at(i - teachers.size());
+    }
+
+    // Calls visitor(const T&) on every entity of each kind it accepts, in the
+    // order above; kinds it has no overload for are skipped entirely
+    template <typename F>
+    void forEach(F&& visitor) const {
+        if constexpr (is_invocable_v<F&, const Student&>) {
+            for (const Student* student : students) visitor(*student);
+        }
+        if constexpr (is_invocable_v<F&, const Teacher&>) {
+            for (const Teacher* teacher : teachers) visitor(*teacher);
+        }
+        if constexpr (is_invocable_v<F&, const Course&>) {
+            for (const Course* course : courses) visitor(*course);
+        }
+    }
+};
+
+// Dispatches one entity to the matching overload of visitor
+template <typename F>
+decltype(auto) visitEntity(EntityRef ref, F&& visitor) {
+    return visit([&](auto* entity) -> decltype(auto) { return visitor(*entity); }, ref);
+}
+
+// --------------------------
+// Analytics Engine
+// --------------------------
+
+// WAM distribution in ten 10-mark bands; 100 lands in the top band
+struct WAMHistogram {
+    array<uint32_t, 10> bands{};
+    uint32_t count = 0;
+    double sum = 0;
+
+    void add(float wam) {
+        bands[min(9, static_cast<int>(wam / 10))]++;
+        count++;
+        sum += wam;
+    }
+
+    void merge(const WAMHistogram& other) {
+        for (size_t i = 0; i < bands.size(); ++i) bands[i] += other.bands[i];
+        count += other.count;
+        sum += other.sum;
+    }
+
+    float mean() const { return count ? static_cast<float>(sum / count) : 0.0f; }
+};
+
+struct CourseAnalytics {
+    SymbolId course_id;
+    int capacity = 0;
+    int enrolled = 0;          // seats taken, from the course
+    int available = 0;
+    float fill_rate = 0;
+    uint32_t roster = 0;       // students listing the course, from the students
+    WAMHistogram wams;         // graded scores in the course
+};
+
+struct DepartmentAnalytics {
+    string department;
+    uint32_t teachers = 0;
+    uint32_t course_load = 0;  // sum of Teacher::courseLoad
+    uint32_t max_course_load = 0;
+    uint32_t courses = 0;      // distinct offered courses taught
+    uint64_t enrolled = 0;
+    uint64_t capacity = 0;
+    float fill_rate = 0;
+    WAMHistogram wams;         // graded scores across those courses
+};
+
+struct GradeLevelAnalytics {
+    uint32_t students = 0;
+    WAMHistogram overall;      // overall WAM of each graded student
+};
+
+// Flat result tables from one refresh, all taken from a single view
+struct AnalyticsReport {
+    uint64_t version = 0;
+    vector<CourseAnalytics> courses;          // in view order
+    vector<DepartmentAnalytics> departments;  // sorted by name
+    array<GradeLevelAnalytics, 4> grade_levels;
+    WAMHistogram all_scores;
+    nanoseconds elapsed{0};
+};
+
+// Map-reduce over the view: students are scanned in parallel chunks, each
+// filling its own dense per-course partials, which are summed at the end.
+// Teachers (far fewer) are folded in serially to build the department side.
+AnalyticsReport computeAnalytics(const EntityStore& store, ThreadPool& pool) {
+    auto start = steady_clock::now();
+    AnalyticsReport report;
+    report.version = store.version();
+    auto students = store.getStudents();
+    auto courses = store.getCourses();
+
+    vector<int32_t> dense(symbols().size(), -1);
+    report.courses.resize(courses.size());
+    for (size_t i = 0; i < courses.size(); ++i) {
+        const Course& course = *courses[i];
+        CourseAnalytics& row = report.courses[i];
+        row.course_id = course.getHandle();
+        row.capacity = course.getCapacity();
+        row.enrolled = course.getEnrolledCount();
+        row.available = course.availableSeats();
+        row.fill_rate = row.capacity > 0 ? float(row.enrolled) / row.capacity : 0.0f;
+        dense[row.course_id] = static_cast<int32_t>(i);
+    }
+
+    struct Partial {
+        vector<uint32_t> roster;
+        vector<WAMHistogram> wams;
+        array<GradeLevelAnalytics, 4> levels;
+        WAMHistogram all;
+    };
+
+    const size_t n = students.size();
+    const size_t chunk = max<size_t>(1024, n / (pool.size() * 4 + 1) + 1);
+    vector<Partial> partials((n + chunk - 1) / chunk);
+    pool.parallelFor(n, chunk, [&](size_t begin, size_t end) {
+        Partial& p = partials[begin / chunk];
+        p.roster.assign(report.courses.size(), 0);
+        p.wams.assign(report.courses.size(), {});
+        for (size_t i = begin; i < end; ++i) {
+            const Student& student = *students[i];
+            double sum = 0;
+            uint32_t graded = 0;
+            {
+                lock_guard<mutex> lock(studentLocks().forKey(student.getHandle()));
+                for (const auto& [course_id, wam] : student.getCourses()) {
+                    int32_t c = course_id < dense.size() ? dense[course_id] : -1;
+                    if (c >= 0) p.roster[c]++;
+                    if (!wam) continue;
+                    if (c >= 0) p.wams[c].add(*wam);
+                    p.all.add(*wam);
+                    sum += *wam;
+                    graded++;
+                }
+            }
+            auto& level = p.levels[static_cast<size_t>(student.getGradeLevel())];
+            level.students++;
+            if (graded) level.overall.add(static_cast<float>(sum / graded));
+        }
+    });
+
+    for (const auto& p : partials) {
+        for (size_t c = 0; c < report.courses.size(); ++c) {
+            report.courses[c].roster += p.roster[c];
+            report.courses[c].wams.merge(p.wams[c]);
+        }
+        for (size_t l = 0; l < p.levels.size(); ++l) {
+            report.grade_levels[l].students += p.levels[l].students;
+            report.grade_levels[l].overall.merge(p.levels[l].overall);
+        }
+        report.all_scores.merge(p.all);
+    }
+
+    unordered_map<string_view, uint32_t> dept_index;
+    vector<pair<uint32_t, int32_t>> taught; // (department, dense course)
+    for (const Teacher* teacher : store.getTeachers()) {
+        auto [it, inserted] = dept_index.try_emplace(teacher->getDepartment(), uint32_t(report.departments.size()));
+        if (inserted) {
+            report.departments.emplace_back();
+            report.departments.back().department = teacher->getDepartment();
+        }
+        DepartmentAnalytics& dept = report.departments[it->second];
+        uint32_t load = teacher->courseLoad();
+        dept.teachers++;
+        dept.course_load += load;
+        dept.max_course_load = max(dept.max_course_load, load);
+        for (SymbolId course_id : teacher->getAssignedCourses()) {
+            int32_t c = course_id < dense.size() ? dense[course_id] : -1;
+            if (c >= 0) taught.emplace_back(it->second, c);
+        }
+    }
+    sort(taught.begin(), taught.end());
+    taught.erase(unique(taught.begin(), taught.end()), taught.end());
+    for (const auto& [d, c] : taught) {
+        DepartmentAnalytics& dept = report.departments[d];
+        const CourseAnalytics& course = report.courses[c];
+        dept.courses++;
+        dept.enrolled += course.enrolled;
+        dept.capacity += max(course.capacity, 0);
+        dept.wams.merge(course.wams);
+    }
+    for (auto& dept : report.departments) {
+        dept.fill_rate = dept.capacity ? float(dept.enrolled) / dept.capacity : 0.0f;
+    }
+    sort(report.departments.begin(), report.departments.end(),
+        [](const DepartmentAnalytics& a, const DepartmentAnalytics& b) { return a.department < b.department; });
+
+    report.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+    return report;
+}
+
+// --------------------------
+// Change Stream
+// --------------------------
+
+// One record per entity a delta touched. `entity` is valid only while the
+// record is being delivered; a deleted entity is reachable through it one
+// last time.
+struct EntityChange {
+    enum Op : uint8_t { INSERTED, UPDATED, DELETED };
+    Op op;
+    SymbolId id;
+    uint64_t version; // first view version that reflects the change
+    EntityRef entity;
+};
+
+// Receives each applied delta's records in one call, in file order, after
+// the new view is published. Runs under College's writer lock, so it must not
+// call College mutators.
+class ChangeObserver {
+public:
+    virtual ~ChangeObserver() = default;
+    virtual void changed(span<const EntityChange> changes) = 0;
+};
+
+// Parsed delta file; see the Delta Files section
+template <typename T>
+struct RosterDelta {
+    shared_ptr<MonotonicArena> arena; // backs the delete ids
+    vector<shared_ptr<T>> upserts;    // file order; the last row for an id wins
+    vector<string_view> deletes;
+};
+
+struct DeltaResult {
+    size_t inserted = 0;
+    size_t updated = 0;
+    size_t deleted = 0;
+    size_t unknown_deletes = 0; // ids not in the college
+    size_t rejected = 0;        // new rows the index refused, left out
+    uint64_t version = 0;       // view version after the delta
+};
+
+// --------------------------
+// Collge Management System
+// --------------------------
+
+class College {
+    string name;
+    // Readers never lock: they load a view. Writers publish under mtx.
+    atomic<shared_ptr<const CollegeView>> current_view{make_shared<const CollegeView>()};
+    mutable mutex entities_mtx;
+    mutable shared_ptr<const EntityStore> entity_cache;
+    // Lookups are lock-free and hold a view while they use the tables and
+    // the entities found, which keeps both alive; mtx serializes writers only
+    ConcurrentDirectory<Student> student_index;
+    ConcurrentDirectory<Teacher> teacher_index;
+    ConcurrentDirectory<Course> course_index;
+    GradeStore grade_store;
+    WAMAggregator aggregates;
+    Leaderboard leaderboard;
+    // Declared after its subscribers so its threads stop before they go away
+    EventBus events;
+    atomic<shared_ptr<const PrerequisiteGraph>> prerequisite_graph;
+    vector<ChangeObserver*> change_observers;
+    // Durable record of enrollments, drops and grades; see openLog
+    unique_ptr<WriteAheadLog> wal;
+    mutable mutex mtx;
+
+    // Makes this thread's logged changes durable per the log's policy
+    void commitLog() {
+        if (wal) wal->commit();
+    }
+
+    bool prerequisitesMet(const Student& student, const Course& course) const {
+        auto graph = prerequisite_graph.load(memory_order_acquire);
+        return !graph || graph->canEnroll(student, course.getHandle());
+    }
+
+    // Undoes roster entries for courses committed during a failed
+    // registerForCourses; the student side was not touched yet
+    static void rollbackCommitted(const Student& student, span<Course* const> committed) {
+        for (Course* course : committed) course->dropStudent(student.getHandle());
+    }
+
+    // Student half of an enrollment whose roster entry is committed. A student
+    // deleted by applyDelta in the meantime refuses it and the seat is given
+    // back, since the delete only cleared the rosters it knew about.
+    static bool finishEnroll(Student& student, Course& course) {
+        if (student.enroll(course.getHandle())) return true;
+        course.dropStudent(student.getHandle());
+        return false;
+    }
+
+    struct BatchRow {
+        size_t row; // index into the caller's statuses
+        Student* student;
+        Course* course;
+    };
+
+    // Rows are grouped by course and each group is seated by one worker,
+    // each row a CAS on the course's seat counter followed by a roster
+    // insert; within a course, rows keep their order so seats go to whoever
+    // came first. Groups run on the thread pool. Returns how many were enrolled.
+    size_t seatRows(vector<BatchRow>& pending, span<EnrollStatus> out) {
+        stable_sort(pending.begin(), pending.end(),
+            [](const BatchRow& a, const BatchRow& b) { return a.course < b.course; });
+
+        vector<size_t> group_starts;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (i == 0 || pending[i].course != pending[i - 1].course) group_starts.push_back(i);
+        }
+        group_starts.push_back(pending.size());
+
+        auto graph = prerequisite_graph.load(memory_order_acquire);
+        atomic<size_t> enrolled{0};
+        defaultPool().parallelFor(group_starts.size() - 1, 16, [&](size_t g_begin, size_t g_end) {
+            vector<SymbolId> ids;
+            vector<size_t> rows_in_group;
+            vector<EnrollStatus> statuses;
+            for (size_t g = g_begin; g < g_end; ++g) {
+                size_t lo = group_starts[g], hi = group_starts[g + 1];
+                Course* course = pending[lo].course;
+                ids.clear();
+                rows_in_group.clear();
+                for (size_t i = lo; i < hi; ++i) {
+                    if (graph && !graph->canEnroll(*pending[i].student, course->getHandle())) {
+                        out[pending[i].row] = EnrollStatus::PREREQ_MISSING;
+                        continue;
+                    }
+                    ids.push_back(pending[i].student->getHandle());
+                    rows_in_group.push_back(i);
+                }
+                statuses.assign(ids.size(), EnrollStatus::NOT_FOUND);
+                course->enrollGroup(ids, statuses);
+
+                for (size_t k = 0; k < rows_in_group.size(); ++k) {
+                    const auto& r = pending[rows_in_group[k]];
+                    if (statuses[k] == EnrollStatus::OK) {
+                        if (finishEnroll(*r.student, *course)) {
+                            enrolled++;
+                        } else {
+                            statuses[k] = EnrollStatus::NOT_FOUND;
+                        }
+                    }
+                    out[r.row] = statuses[k];
+                }
+            }
+        });
+        if (wal && enrolled) wal->commitAll(); // one wait covers every worker's records
+        return enrolled;
+    }
+
+    vector<pair<string, float>> withNames(const vector<pair<SymbolId, float>>& ranked) const {
+        auto pin = view();
+        vector<pair<string, float>> named;
+        named.reserve(ranked.size());
+        for (const auto& [handle, wam] : ranked) {
+            const Student* student = student_index.findRaw(symbols().name(handle));
+            if (student) named.emplace_back(student->getName(), wam);
+        }
+        return named;
+    }
+
+    // Caller holds mtx
+    const CollegeView& viewLocked() const { return *current_view.load(memory_order_relaxed); }
+
+    // Caller holds mtx. Frees `garbage` once no view current up to now is held.
+    void retireLocked(shared_ptr<const void> garbage) {
+        if (garbage) viewLocked().epoch->retired.push_back(move(garbage));
+    }
+
+    // Caller holds mtx. Every publish goes through here so that index tables
+    // replaced under the outgoing view are retired with it.
+    void storeViewLocked(shared_ptr<CollegeView> next) {
+        auto retireAll = [&](vector<shared_ptr<const void>> tables) {
+            for (auto& table : tables) retireLocked(move(table));
+        };
+        retireAll(student_index.takeRetired());
+        retireAll(teacher_index.takeRetired());
+        retireAll(course_index.takeRetired());
+        const CollegeView& now = viewLocked();
+        next->epoch = make_shared<ViewEpoch>();
+        now.epoch->next = next->epoch;
+        current_view.store(move(next), memory_order_release);
+    }
+
+    void publishLocked(span<const shared_ptr<Student>> new_students, span<const shared_ptr<Teacher>> new_teachers,
+                       span<const shared_ptr<Course>> new_courses) {
+        const CollegeView& now = viewLocked();
+        auto next = make_shared<CollegeView>();
+        next->version = now.version + 1;
+        next->students = now.students.appended(new_students);
+        next->teachers = now.teachers.appended(new_teachers);
+        next->courses = now.courses.appended(new_courses);
+        storeViewLocked(move(next));
+    }
+
+    // Caller holds mtx. Indexes students from slot base on and returns how
+    // many were registered before the first duplicate id.
+    size_t registerStudentsLocked(span<const shared_ptr<Student>> batch, size_t base) {
+        student_index.reserve(base + batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            Student& student = *batch[i];
+            if (!student_index.insert(student.getId(), base + i, batch[i])) return i;
+            grade_store.addStudent(student);
+            aggregates.addStudent(student);
+            leaderboard.addStudent(student);
+            student.attachEventBus(&events);
+            if (wal) student.attachLog(wal.get());
+        }
+        return batch.size();
+    }
+
+    size_t registerTeachersLocked(span<const shared_ptr<Teacher>> batch, size_t base) {
+        teacher_index.reserve(base + batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const Teacher& teacher = *batch[i];
+            if (!teacher_index.insert(teacher.getId(), base + i, batch[i])) return i;
+            for (SymbolId course_id : teacher.getAssignedCourses()) {
+                aggregates.linkCourse(course_id, teacher.getDepartment());
+            }
+        }
+        return batch.size();
+    }
+
+    // Takes a departing student out of rosters and derived state. Its bus is
+    // already detached and drained, so no event for it is still in flight.
+    void retireStudentLocked(Student& student) {
+        CourseScores courses = student.retire();
+        for (const auto& entry : courses) {
+            if (Course* course = course_index.findRaw(symbols().name(entry.first))) {
+                course->dropStudent(student.getHandle());
+            }
+        }
+        grade_store.removeStudent(student.getHandle(), courses);
+        aggregates.removeStudent(courses);
+        leaderboard.removeStudent(student.getHandle(), courses);
+    }
+
+    // Drops (course, department) links that no teacher in `teachers` backs any more
+    void unlinkOrphanedLocked(vector<pair<SymbolId, string_view>> links, const SegmentedList<Teacher>& teachers) {
+        sort(links.begin(), links.end());
+        links.erase(unique(links.begin(), links.end()), links.end());
+        for (const auto& [course_id, department] : links) {
+            bool taught = any_of(teachers.begin(), teachers.end(), [&](const shared_ptr<Teacher>& t) {
+                return t->getDepartment() == department && t->teaches(course_id);
+            });
+            if (!taught) aggregates.unlinkCourse(course_id, department);
+        }
+    }
+
+    void publishChangesLocked(shared_ptr<CollegeView> next, span<const EntityChange> changes) {
+        storeViewLocked(move(next));
+        for (ChangeObserver* observer : change_observers) observer->changed(changes);
+    }
+
+public:
+    College(string name) : name(name) {
+        // Aggregates and leaderboards only need the net change per batch
+        events.subscribe(&grade_store, true);
+        events.subscribe(&aggregates, true);
+        events.subscribe(&leaderboard, true);
+    }
+
+    void addStudent(shared_ptr<Student> student) {
+        addStudents({move(student)});
+    }
+
+    void addTeacher(shared_ptr<Teacher> teacher) {
+        addTeachers({move(teacher)});
+    }
+
+    // Bulk variants take the lock once and publish one new view; ids are
+    // validated in order, so a duplicate leaves everything before it added,
+    // same as repeated add calls.
+    void addStudents(vector<shared_ptr<Student>>&& batch) {
+        lock_guard<mutex> lock(mtx);
+        size_t added = registerStudentsLocked(batch, viewLocked().students.size());
+        publishLocked(span(batch).first(added), {}, {});
+        if (added < batch.size()) throw runtime_error("Duplicate student id: " + batch[added]->getId());
+        batch.clear();
+    }
+
+    void addTeachers(vector<shared_ptr<Teacher>>&& batch) {
+        lock_guard<mutex> lock(mtx);
+        size_t added = registerTeachersLocked(batch, viewLocked().teachers.size());
+        publishLocked({}, span(batch).first(added), {});
+        if (added < batch.size()) throw runtime_error("Duplicate teacher id: " + batch[added]->getId());
+        batch.clear();
+    }
+
+    // Applies a student delta as one new view. Upserts of known ids update the
+    // profile and grade level in place, keeping enrollments and grades; new
+    // ids are added as by addStudents. Deletes drop the student from course
+    // rosters, grade aggregates, leaderboards and the view; the last student
+    // takes each freed slot. Cost is proportional to the delta, not the roster.
+    DeltaResult applyDelta(RosterDelta<Student>&& delta) {
+        lock_guard<mutex> lock(mtx);
+        const CollegeView& now = viewLocked();
+        DeltaResult result;
+        result.version = now.version + 1;
+        vector<EntityChange> changes;
+
+        vector<shared_ptr<Student>> fresh;
+        unordered_map<string_view, size_t> pending; // id -> index in fresh
+        for (auto& row : delta.upserts) {
+            if (Student* current = student_index.findRaw(row->getId())) {
+                retireLocked(current->setProfile(row->getName(), row->getEmail(), row->getAddress()));
+                if (current->getGradeLevel() != row->getGradeLevel()) {
+                    current->setGradeLevel(row->getGradeLevel());
+                    leaderboard.setGradeLevel(current->getHandle(), row->getGradeLevel());
+                }
+                changes.push_back({EntityChange::UPDATED, current->getHandle(), result.version, current});
+                result.updated++;
+            } else if (auto [it, inserted] = pending.try_emplace(row->getId(), fresh.size()); inserted) {
+                fresh.push_back(move(row));
+            } else {
+                fresh[it->second] = move(row);
+            }
+        }
+        size_t registered = registerStudentsLocked(fresh, now.students.size());
+        if (registered < fresh.size()) {
+            result.rejected = fresh.size() - registered;
+            cerr << RED << "Duplicate student id in delta: " << fresh[registered]->getId() << RESET << endl;
+            fresh.resize(registered);
+        }
+        for (const auto& student : fresh) {
+            changes.push_back({EntityChange::INSERTED, student->getHandle(), result.version, student.get()});
+        }
+        result.inserted = fresh.size();
+
+        vector<size_t> slots;
+        vector<shared_ptr<Student>> retired;
+        for (string_view id : delta.deletes) {
+            auto slot = student_index.findSlot(id);
+            auto student = student_index.erase(id);
+            if (!student) {
+                result.unknown_deletes++;
+                continue;
+            }
+            student->attachEventBus(nullptr);
+            slots.push_back(*slot);
+            retired.push_back(move(student));
+        }
+        if (!retired.empty()) events.sync();
+        for (const auto& student : retired) {
+            retireStudentLocked(*student);
+            changes.push_back({EntityChange::DELETED, student->getHandle(), result.version, student.get()});
+        }
+        result.deleted = retired.size();
+
+        if (changes.empty()) {
+            result.version = now.version;
+            return result;
+        }
+        auto next = make_shared<CollegeView>(now);
+        next->version = result.version;
+        next->students = now.students.appended(fresh).swapRemoved(move(slots),
+            [&](const shared_ptr<Student>& student, size_t slot) {
+                student_index.setSlot(student->getId(), slot);
+            });
+        publishChangesLocked(move(next), changes);
+        return result;
+    }
+
+    // Teacher counterpart. A department change relinks the teacher's courses
+    // in the department aggregates, and links no teacher backs any more are
+    // dropped; that check scans the teacher list, which is small.
+    DeltaResult applyDelta(RosterDelta<Teacher>&& delta) {
+        lock_guard<mutex> lock(mtx);
+        const CollegeView& now = viewLocked();
+        DeltaResult result;
+        result.version = now.version + 1;
+        vector<EntityChange> changes;
+        vector<pair<SymbolId, string_view>> stale_links; // (course, former department)
+
+        vector<shared_ptr<Teacher>> fresh;
+        unordered_map<string_view, size_t> pending;
+        for (auto& row : delta.upserts) {
+            if (Teacher* current = teacher_index.findRaw(row->getId())) {
+                retireLocked(current->setProfile(row->getName(), row->getEmail(), row->getAddress()));
+                string_view department = current->getDepartment();
+                if (department != row->getDepartment() || current->getSpecialization() != row->getSpecialization()) {
+                    retireLocked(current->setAppointment(row->getDepartment(), row->getSpecialization()));
+                }
+                if (department != current->getDepartment()) {
+                    for (SymbolId course_id : current->getAssignedCourses()) {
+                        stale_links.emplace_back(course_id, department);
+                        aggregates.linkCourse(course_id, current->getDepartment());
+                    }
+                }
+                changes.push_back({EntityChange::UPDATED, current->getHandle(), result.version, current});
+                result.updated++;
+            } else if (auto [it, inserted] = pending.try_emplace(row->getId(), fresh.size()); inserted) {
+                fresh.push_back(move(row));
+            } else {
+                fresh[it->second] = move(row);
+            }
+        }
+        size_t registered = registerTeachersLocked(fresh, now.teachers.size());
+        if (registered < fresh.size()) {
+            result.rejected = fresh.size() - registered;
+            cerr << RED << "Duplicate teacher id in delta: " << fresh[registered]->getId() << RESET << endl;
+            fresh.resize(registered);
+        }
+        for (const auto& teacher : fresh) {
+            changes.push_back({EntityChange::INSERTED, teacher->getHandle(), result.version, teacher.get()});
+        }
+        result.inserted = fresh.size();
+
+        vector<size_t> slots;
+        vector<shared_ptr<Teacher>> retired;
+        for (string_view id : delta.deletes) {
+            auto slot = teacher_index.findSlot(id);
+            auto teacher = teacher_index.erase(id);
+            if (!teacher) {
+                result.unknown_deletes++;
+                continue;
+            }
+            for (SymbolId course_id : teacher->getAssignedCourses()) {
+                stale_links.emplace_back(course_id, teacher->getDepartment());
+            }
+            changes.push_back({EntityChange::DELETED, teacher->getHandle(), result.version, teacher.get()});
+            slots.push_back(*slot);
+            retired.push_back(move(teacher));
+        }
+        result.deleted = retired.size();
+
+        if (changes.empty()) {
+            result.version = now.version;
+            return result;
+        }
+        auto next = make_shared<CollegeView>(now);
+        next->version = result.version;
+        next->teachers = now.teachers.appended(fresh).swapRemoved(move(slots),
+            [&](const shared_ptr<Teacher>& teacher, size_t slot) { teacher_index.setSlot(teacher->getId(), slot); });
+        unlinkOrphanedLocked(move(stale_links), next->teachers);
+        publishChangesLocked(move(next), changes);
+        return result;
+    }
+
+    void addChangeObserver(ChangeObserver* observer) {
+        lock_guard<mutex> lock(mtx);
+        change_observers.push_back(observer);
+    }
+
+    void addCourse(shared_ptr<Course> course) {
+        addCourses({move(course)});
+    }
+
+    void addCourses(vector<shared_ptr<Course>>&& batch) {
+        lock_guard<mutex> lock(mtx);
+        size_t base = viewLocked().courses.size();
+        course_index.reserve(base + batch.size());
+        size_t added = 0;
+        try {
+            for (; added < batch.size(); ++added) {
+                if (!course_index.insert(batch[added]->getId(), base + added, batch[added])) {
+                    throw runtime_error("Duplicate course id: " + batch[added]->getId());
+                }
+            }
+        } catch (...) {
+            publishLocked({}, {}, span(batch).first(added));
+            throw;
+        }
+        publishLocked({}, {}, batch);
+        batch.clear();
+    }
+
+    // Current membership; cheap to take and safe to hold across writes
+    shared_ptr<const CollegeView> view() const {
+        return current_view.load(memory_order_acquire);
+    }
+
+    shared_ptr<Student> findStudent(string_view id) const {
+        auto pin = view();
+        return student_index.find(id);
+    }
+
+    shared_ptr<Teacher> findTeacher(string_view id) const {
+        auto pin = view();
+        return teacher_index.find(id);
+    }
+
+    shared_ptr<Course> findCourse(string_view id) const {
+        auto pin = view();
+        return course_index.find(id);
+    }
+
+    // Takes no College-wide lock: the seat is claimed with a CAS on the
+    // course's seat counter, the roster entry under one member shard and the
+    // student update under the student's lock stripe, so enrollments proceed
+    // in parallel, even into the same course
+    bool enrollStudentInCourse(const string& student_id, const string& course_id) {
+        SCOPED_TIMER(Metric::ENROLL);
+        auto pin = view();
+        Student* student = student_index.findRaw(student_id);
+        Course* course = course_index.findRaw(course_id);
+
+        if (!student || !course) {
+            countMetric(Counter::ENROLL_REJECTED);
+            cerr << RED << "Student or course not found!" << RESET << endl;
+            return false;
+        }
+
+        if (!prerequisitesMet(*student, *course)) {
+            countMetric(Counter::ENROLL_REJECTED);
+            cerr << RED << "Missing prerequisites for " << course_id << "!" << RESET << endl;
+            return false;
+        }
+
+        if (course->enrollStudent(student->getHandle())) {
+            if (!finishEnroll(*student, *course)) {
+                countMetric(Counter::ENROLL_REJECTED);
+                cerr << RED << "Student or course not found!" << RESET << endl;
+                return false;
+            }
+            commitLog();
+            return true;
+        }
+        
+        countMetric(Counter::ENROLL_REJECTED);
+        cerr << RED << "Course " << course_id << " is full!" << RESET << endl;
+        return false;
+    }
+
+    // See seatRows: one worker per course claiming seats by CAS, input order
+    // wins within a course
+    BatchEnrollResult enrollBatch(span<const pair<string, string>> rows) {
+        auto start = steady_clock::now();
+        BatchEnrollResult result;
+        result.statuses.assign(rows.size(), EnrollStatus::NOT_FOUND);
+
+        auto pin = view();
+        vector<BatchRow> pending;
+        pending.reserve(rows.size());
+        for (size_t i = 0; i < rows.size(); ++i) {
+            Student* student = student_index.findRaw(rows[i].first);
+            Course* course = course_index.findRaw(rows[i].second);
+            if (student && course) {
+                pending.push_back({i, student, course});
+            }
+        }
+
+        result.enrolled = seatRows(pending, result.statuses);
+        countMetric(Counter::ENROLL_REJECTED, rows.size() - result.enrolled);
+
+        result.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        return result;
+    }
+
+    // Places every request's ranked courses in one solve instead of one
+    // enrollment call per preference: unknown, duplicate and prerequisite-
+    // blocked entries are filtered up front, free seats are matched by
+    // solveSeatAllocation, and the matching is committed through seatRows.
+    AllocationResult allocateSeats(span<const SeatPreferences> requests, const AllocationOptions& options = {}) {
+        auto start = steady_clock::now();
+        AllocationResult result;
+        result.placements.resize(requests.size());
+        auto v = view();
+        const auto& courses = v->courses;
+        auto graph = prerequisite_graph.load(memory_order_acquire);
+
+        vector<int32_t> dense(symbols().size(), -1);
+        vector<int> free_seats(courses.size());
+        for (size_t c = 0; c < courses.size(); ++c) {
+            SymbolId handle = courses[c]->getHandle();
+            if (handle >= dense.size()) dense.resize(handle + 1, -1);
+            dense[handle] = int32_t(c);
+            free_seats[c] = courses[c]->availableSeats();
+        }
+
+        vector<SeatApplicant> applicants(requests.size());
+        atomic<size_t> requested{0}, not_found{0}, duplicate{0}, prereq_missing{0};
+        defaultPool().parallelFor(requests.size(), 256, [&](size_t begin, size_t end) {
+            vector<uint64_t> passed;
+            size_t entries = 0, missing = 0, repeats = 0, blocked = 0;
+            for (size_t r = begin; r < end; ++r) {
+                const auto& request = requests[r];
+                auto& applicant = applicants[r];
+                entries += request.courses.size();
+                Student* student = student_index.findRaw(request.student_id);
+                if (!student) {
+                    missing += request.courses.size();
+                    continue;
+                }
+                applicant.student = student;
+                applicant.priority = allocationPriority(*student, options.seed);
+                if (graph) graph->passedBits(*student, passed);
+                for (const auto& course_id : request.courses) {
+                    Course* course = course_index.findRaw(course_id);
+                    SymbolId handle = course ? course->getHandle() : 0;
+                    if (!course || handle >= dense.size() || dense[handle] < 0) {
+                        missing++;
+                        continue;
+                    }
+                    uint32_t c = uint32_t(dense[handle]);
+                    if (student->isEnrolledIn(handle) || ranges::find(applicant.courses, c) != applicant.courses.end()) {
+                        repeats++;
+                    } else if (graph && !graph->satisfied(handle, passed)) {
+                        blocked++;
+                    } else {
+                        applicant.courses.push_back(c);
+                    }
+                }
+            }
+            requested += entries;
+            not_found += missing;
+            duplicate += repeats;
+            prereq_missing += blocked;
+        });
+        result.requested = requested;
+        result.not_found = not_found;
+        result.duplicate = duplicate;
+        result.prereq_missing = prereq_missing;
+
+        SeatSolution solution = solveSeatAllocation(applicants, free_seats, options.max_courses);
+        result.rounds = solution.rounds;
+
+        vector<BatchRow> rows;
+        vector<pair<uint32_t, SeatHolder>> seated; // (course, holder) per row
+        for (size_t c = 0; c < solution.holders.size(); ++c) {
+            auto& holders = solution.holders[c];
+            // Highest priority first, so a racing enrollment costs the lowest-ranked seat
+            sort(holders.begin(), holders.end(), [&](const SeatHolder& a, const SeatHolder& b) {
+                return applicants[a.applicant].priority > applicants[b.applicant].priority;
+            });
+            for (const SeatHolder& holder : holders) {
+                rows.push_back({rows.size(), applicants[holder.applicant].student, courses[c].get()});
+                seated.emplace_back(uint32_t(c), holder);
+            }
+        }
+        auto solved = steady_clock::now();
+        result.solve_elapsed = duration_cast<nanoseconds>(solved - start);
+
+        vector<EnrollStatus> statuses(rows.size(), EnrollStatus::NOT_FOUND);
+        result.placed = seatRows(rows, statuses);
+        result.commit_elapsed = duration_cast<nanoseconds>(steady_clock::now() - solved);
+
+        vector<tuple<uint32_t, uint32_t, SymbolId>> ranked; // (request, rank, course)
+        ranked.reserve(result.placed);
+        for (size_t k = 0; k < seated.size(); ++k) {
+            const auto& [c, holder] = seated[k];
+            switch (statuses[k]) {
+                case EnrollStatus::OK:
+                    ranked.emplace_back(holder.applicant, holder.rank, courses[c]->getHandle());
+                    break;
+                case EnrollStatus::DUPLICATE: result.duplicate++; break;
+                case EnrollStatus::PREREQ_MISSING: result.prereq_missing++; break;
+                default: result.lost++; break;
+            }
+        }
+        sort(ranked.begin(), ranked.end());
+        for (const auto& [request, _, handle] : ranked) result.placements[request].push_back(handle);
+        countMetric(Counter::ENROLL_REJECTED, result.requested - result.placed);
+        return result;
+    }
+
+    // Rebuilds the prerequisite DAG from the current courses and starts
+    // enforcing it on enrollment. Call again after changing prerequisites;
+    // throws (keeping the previous graph) if they contain a cycle.
+    void buildPrerequisiteGraph() {
+        auto courses = view()->courses.toVector();
+        prerequisite_graph.store(make_shared<const PrerequisiteGraph>(courses), memory_order_release);
+    }
+
+    shared_ptr<const PrerequisiteGraph> getPrerequisiteGraph() const {
+        return prerequisite_graph.load(memory_order_acquire);
+    }
+
+    // Courses each listed student could enroll in now, in parallel
+    vector<vector<string>> getEligibleCourses(span<const string> student_ids) const {
+        auto graph = prerequisite_graph.load(memory_order_acquire);
+        auto pin = view();
+        auto offered = pin->courses.toVector();
+        if (!graph) graph = make_shared<const PrerequisiteGraph>(offered);
+
+        vector<const Student*> cohort;
+        vector<size_t> positions;
+        for (size_t i = 0; i < student_ids.size(); ++i) {
+            if (const Student* s = student_index.findRaw(student_ids[i])) {
+                cohort.push_back(s);
+                positions.push_back(i);
+            }
+        }
+        auto eligible = graph->eligibleCourses(cohort, offered);
+
+        vector<vector<string>> result(student_ids.size());
+        for (size_t i = 0; i < cohort.size(); ++i) {
+            for (SymbolId c : eligible[i]) result[positions[i]].push_back(symbols().name(c));
+        }
+        return result;
+    }
+
+    // All-or-nothing registration into several courses: a seat is reserved
+    // in every course first and only committed once all reservations hold.
+    // Returns OK, or the first failure; on failure nothing is enrolled.
+    EnrollStatus registerForCourses(string_view student_id, span<const string> course_ids) {
+        auto pin = view();
+        Student* student = student_index.findRaw(student_id);
+        if (!student) return EnrollStatus::NOT_FOUND;
+
+        vector<Course*> targets;
+        for (const auto& course_id : course_ids) {
+            Course* course = course_index.findRaw(course_id);
+            if (!course) return EnrollStatus::NOT_FOUND;
+            if (course->isEnrolled(student->getHandle())) return EnrollStatus::DUPLICATE;
+            if (!prerequisitesMet(*student, *course)) return EnrollStatus::PREREQ_MISSING;
+            targets.push_back(course);
+        }
+
+        vector<SeatReservation> seats;
+        for (Course* course : targets) {
+            SeatReservation seat(*course);
+            if (!seat) return EnrollStatus::FULL; // earlier seats roll back
+            seats.push_back(move(seat));
+        }
+
+        // A concurrent enrollment of the same student can still win a commit
+        // race; undo what we committed so the call stays all-or-nothing
+        for (size_t i = 0; i < seats.size(); ++i) {
+            if (seats[i].commit(student->getHandle()) != EnrollStatus::OK) {
+                rollbackCommitted(*student, span<Course* const>(targets.data(), i));
+                return EnrollStatus::DUPLICATE;
+            }
+        }
+        for (Course* course : targets) {
+            if (!student->enroll(course->getHandle())) {
+                rollbackCommitted(*student, targets); // deleted meanwhile
+                return EnrollStatus::NOT_FOUND;
+            }
+        }
+        commitLog();
+        return EnrollStatus::OK;
+    }
+
+    // Enrolls, or queues the student on the course waitlist when it is full
+    EnrollStatus enrollOrWaitlist(string_view student_id, string_view course_id) {
+        auto pin = view();
+        Student* student = student_index.findRaw(student_id);
+        Course* course = course_index.findRaw(course_id);
+        if (!student || !course) return EnrollStatus::NOT_FOUND;
+        if (!prerequisitesMet(*student, *course)) return EnrollStatus::PREREQ_MISSING;
+
+        EnrollStatus status = course->tryEnroll(student->getHandle());
+        if (status == EnrollStatus::OK) {
+            if (!finishEnroll(*student, *course)) return EnrollStatus::NOT_FOUND;
+            commitLog();
+        } else if (status == EnrollStatus::FULL) {
+            course->joinWaitlist(student->getHandle());
+        }
+        return status;
+    }
+
+    // Moves waitlisted students into any seats that have opened up; returns
+    // how many were enrolled
+    size_t promoteWaitlist(string_view course_id) {
+        auto pin = view();
+        Course* course = course_index.findRaw(course_id);
+        if (!course) return 0;
+        size_t promoted = 0;
+        while (course->availableSeats() > 0) {
+            auto next = course->popWaitlist();
+            if (!next) break;
+            Student* student = student_index.findRaw(symbols().name(*next));
+            if (!student) continue;
+            EnrollStatus status = course->tryEnroll(*next);
+            if (status == EnrollStatus::OK) {
+                if (finishEnroll(*student, *course)) promoted++;
+            } else if (status == EnrollStatus::FULL) {
+                course->joinWaitlist(*next); // lost the seat to a racer
+                break;
+            }
+        }
+        if (promoted) commitLog();
+        return promoted;
+    }
+
+    // Frees the seat, then removes the course and its grade from the student.
+    // Seat first, like enrollment: whatever a checkpoint's snapshot misses of
+    // the change is still in the log it keeps.
+    bool dropStudentFromCourse(string_view student_id, string_view course_id) {
+        auto pin = view();
+        Student* student = student_index.findRaw(student_id);
+        Course* course = course_index.findRaw(course_id);
+        if (!student || !course) return false;
+        if (!course->dropStudent(student->getHandle())) return false;
+        student->drop(course->getHandle());
+        commitLog();
+        return true;
+    }
+
+    // What registerForCourses checks for one course, short of seats, without
+    // changing anything
+    EnrollStatus checkEnrollment(string_view student_id, string_view course_id) const {
+        auto pin = view();
+        Student* student = student_index.findRaw(student_id);
+        Course* course = course_index.findRaw(course_id);
+        if (!student || !course) return EnrollStatus::NOT_FOUND;
+        if (course->isEnrolled(student->getHandle())) return EnrollStatus::DUPLICATE;
+        if (!prerequisitesMet(*student, *course)) return EnrollStatus::PREREQ_MISSING;
+        return EnrollStatus::OK;
+    }
+
+    // Seat half of an enrollment whose student lives on another shard: only
+    // this college's roster for the course changes, and nothing is logged.
+    // See ShardedCollege.
+    EnrollStatus reserveSeat(string_view student_id, string_view course_id) {
+        auto pin = view();
+        Course* course = course_index.findRaw(course_id);
+        if (!course) return EnrollStatus::NOT_FOUND;
+        return course->tryEnroll(symbols().intern(student_id));
+    }
+
+    bool releaseSeat(string_view student_id, string_view course_id) {
+        auto pin = view();
+        Course* course = course_index.findRaw(course_id);
+        auto student = symbols().lookup(student_id);
+        return course && student && course->dropStudent(*student);
+    }
+
+    // Assigns through College so department WAM totals learn the course
+    void assignCourse(Teacher& teacher, string_view course_id) {
+        lock_guard<mutex> lock(mtx);
+        SymbolId handle = symbols().intern(course_id);
+        teacher.assignCourse(handle);
+        aggregates.linkCourse(handle, teacher.getDepartment());
+    }
+
+    // Department half of assignCourse for a teacher who lives on another
+    // shard: grades recorded here for the course count towards department
+    void linkCourseDepartment(string_view course_id, string_view department) {
+        lock_guard<mutex> lock(mtx);
+        aggregates.linkCourse(symbols().intern(course_id), department);
+    }
+
+    // One pass over every teacher. Department links are deduplicated so each
+    // (course, department) pair reaches the aggregates once.
+    size_t assignCourses(const CourseAssignmentRules& rules) {
+        lock_guard<mutex> lock(mtx);
+        vector<pair<SymbolId, string_view>> links;
+        size_t assigned = 0;
+        for (const auto& teacher : viewLocked().teachers) {
+            for (SymbolId course_id : rules.coursesFor(teacher->getSpecializationKind())) {
+                teacher->assignCourse(course_id);
+                links.emplace_back(course_id, teacher->getDepartment());
+                assigned++;
+            }
+        }
+        sort(links.begin(), links.end());
+        links.erase(unique(links.begin(), links.end()), links.end());
+        for (const auto& [course_id, department] : links) aggregates.linkCourse(course_id, department);
+        return assigned;
+    }
+
+    // Waits for derived state (grade store, aggregates, leaderboards) to catch
+    // up with every grade and enrollment made so far. Readers below do this
+    // themselves.
+    void flushEvents() const { events.sync(); }
+
+    // O(1) reads of the running aggregates
+    float getCourseWAM(string_view course_id) const {
+        return getCourseTotals(course_id).mean();
+    }
+
+    // Sum and count behind getCourseWAM, for merging across shards
+    WAMAggregate getCourseTotals(string_view course_id) const {
+        events.sync();
+        auto handle = symbols().lookup(course_id);
+        return handle ? aggregates.course(*handle) : WAMAggregate{};
+    }
+
+    float getDepartmentWAM(const string& department) const {
+        return getDepartmentTotals(department).mean();
+    }
+
+    map<string, float> getDepartmentWAMs() const {
+        map<string, float> result;
+        for (const auto& [dept, agg] : getDepartmentTotals()) {
+            result[dept] = agg.mean();
+        }
+        return result;
+    }
+
+    // Sums and counts behind the department WAMs, for merging across shards
+    WAMAggregate getDepartmentTotals(const string& department) const {
+        events.sync();
+        return aggregates.department(department);
+    }
+
+    map<string, WAMAggregate> getDepartmentTotals() const {
+        events.sync();
+        return aggregates.departments();
+    }
+
+    // Course, department and grade-level rollups in one parallel pass over
+    // the current view; reads grades directly, so no event sync is needed
+    AnalyticsReport getAnalytics() const {
+        return computeAnalytics(*entities(), defaultPool());
+    }
+
+    map<string, int> getDepartmentStats() const {
+        map<string, int> stats;
+        for (const auto& teacher : view()->teachers) {
+            stats[string(teacher->getDepartment())]++;
+        }
+        return stats;
+    }
+
+    // Overall WAM of every student, indexed like getStudents()
+    vector<float> getAllOverallWAMs() const {
+        return getAllOverallWAMs(*view());
+    }
+
+    vector<float> getAllOverallWAMs(const CollegeView& v) const {
+        events.sync();
+        return grade_store.overallWAMs(v.studentHandles());
+    }
+
+    // Credit-weighted WAM of every student, indexed like getStudents()
+    vector<float> getAllCreditWeightedWAMs() const {
+        auto v = view();
+        events.sync();
+        vector<float> credits(symbols().size(), 0.0f);
+        for (const auto& course : v->courses) {
+            credits[course->getHandle()] = course->getCredits();
+        }
+        return grade_store.weightedWAMs(v->studentHandles(),
+            [&credits](SymbolId c) { return c < credits.size() ? credits[c] : 0.0f; });
+    }
+
+    vector<pair<string, float>> getCourseAverages() const {
+        events.sync();
+        vector<pair<string, float>> averages;
+        for (const auto& [course_id, avg] : grade_store.courseAverages()) {
+            averages.emplace_back(symbols().name(course_id), avg);
+        }
+        return averages;
+    }
+
+    float getCollegeWAM() const {
+        events.sync();
+        return grade_store.collegeWAM();
+    }
+
+    // One-shot top-n: partial_sort over slots, names copied only for the
+    // winners. Ties go to the lower student handle, as on the leaderboard.
+    vector<tuple<SymbolId, string, float>> getRankedPerformers(int n) const {
+        auto v = view();
+        const auto& students = v->students;
+        auto wams = getAllOverallWAMs(*v);
+        vector<uint32_t> order(wams.size());
+        iota(order.begin(), order.end(), 0);
+
+        size_t k = min<size_t>(max(n, 0), order.size());
+        partial_sort(order.begin(), order.begin() + k, order.end(),
+            [&](uint32_t a, uint32_t b) {
+                return wams[a] != wams[b] ? wams[a] > wams[b]
+                                          : students[a]->getHandle() < students[b]->getHandle();
+            });
+
+        vector<tuple<SymbolId, string, float>> performers;
+        performers.reserve(k);
+        for (size_t i = 0; i < k; ++i) {
+            const auto& student = students[order[i]];
+            performers.emplace_back(student->getHandle(), student->getName(), wams[order[i]]);
+        }
+        return performers;
+    }
+
+    vector<pair<string, float>> getTopPerformers(int n) const {
+        vector<pair<string, float>> performers;
+        for (auto& [_, name, wam] : getRankedPerformers(n)) performers.emplace_back(move(name), wam);
+        return performers;
+    }
+
+    // Live leaderboard queries, maintained from WAM change notifications
+    vector<pair<string, float>> getLiveTopPerformers(size_t k) const {
+        events.sync();
+        return withNames(leaderboard.top(k));
+    }
+
+    vector<pair<string, float>> getCourseTopPerformers(string_view course_id, size_t k) const {
+        events.sync();
+        auto handle = symbols().lookup(course_id);
+        return handle ? withNames(leaderboard.topInCourse(*handle, k)) : vector<pair<string, float>>{};
+    }
+
+    vector<pair<string, float>> getGradeLevelTopPerformers(GradeLevel level, size_t k) const {
+        events.sync();
+        return withNames(leaderboard.topInGradeLevel(level, k));
+    }
+
+    // 1-based rank by overall WAM, nullopt for unknown students
+    optional<size_t> getStudentRank(string_view student_id) const {
+        events.sync();
+        auto handle = symbols().lookup(student_id);
+        return handle ? leaderboard.rank(*handle) : nullopt;
+    }
+
+    optional<size_t> getStudentCourseRank(string_view student_id, string_view course_id) const {
+        events.sync();
+        auto student = symbols().lookup(student_id);
+        auto course = symbols().lookup(course_id);
+        return (student && course) ? leaderboard.rankInCourse(*student, *course) : nullopt;
+    }
+
+    // Reports in student order. Students are formatted in bounded chunks on
+    // the shared pool, each worker reusing one scratch buffer for its chunk.
+    vector<string> generateAllStudentReports(size_t chunk = 256) const {
+        SCOPED_TIMER(Metric::REPORT_GENERATION);
+        auto store = entities();
+        auto students = store->getStudents();
+        countMetric(Counter::REPORTS_WRITTEN, students.size());
+        vector<string> reports(students.size());
+        defaultPool().parallelFor(students.size(), chunk, [&](size_t begin, size_t end) {
+            static thread_local string buffer;
+            for (size_t i = begin; i < end; ++i) {
+                buffer.clear();
+                appendStudentReport(buffer, *students[i]);
+                reports[i] = buffer;
+            }
+        });
+        return reports;
+    }
+
+    // Streams every report to sink in student order without materialising
+    // them. Students are formatted batch_size at a time into per-chunk buffers
+    // on the pool; batch k is written while batch k+1 is being formatted, so
+    // memory stays at two batches regardless of student count.
+    void streamAllStudentReports(ReportSink& sink, ReportFormat format = ReportFormat::Plain,
+                                 size_t batch_size = 4096) const {
+        SCOPED_TIMER(Metric::REPORT_GENERATION);
+        auto store = entities();
+        auto students = store->getStudents();
+        countMetric(Counter::REPORTS_WRITTEN, students.size());
+        constexpr size_t CHUNKS_PER_BATCH = 64;
+        batch_size = max<size_t>(batch_size, 1);
+        size_t chunk = max<size_t>(batch_size / CHUNKS_PER_BATCH, 1);
+        size_t chunks = (batch_size + chunk - 1) / chunk;
+
+        array<vector<string>, 2> buffers{vector<string>(chunks), vector<string>(chunks)};
+        array<vector<string_view>, 2> views;
+
+        size_t b = 0;
+        for (size_t begin = 0; begin < students.size(); begin += batch_size, b ^= 1) {
+            size_t end = min(students.size(), begin + batch_size);
+            size_t count = (end - begin + chunk - 1) / chunk;
+            auto& bufs = buffers[b];
+            // Task 0 hands the previous batch to the sink while the rest
+            // format this one into the other buffer
+            defaultPool().parallelFor(count + 1, 1, [&](size_t t, size_t) {
+                if (t == 0) {
+                    if (!views[b ^ 1].empty()) sink.write(views[b ^ 1]);
+                    return;
+                }
+                string& out = bufs[t - 1];
+                out.clear();
+                for (size_t i = begin + (t - 1) * chunk; i < min(end, begin + t * chunk); ++i) {
+                    appendStudentReport(out, *students[i], format);
+                }
+            });
+
+            views[b ^ 1].clear();
+            views[b].assign(bufs.begin(), bufs.begin() + count);
+        }
+        if (!views[b ^ 1].empty()) sink.write(views[b ^ 1]);
+    }
+
+    void simulateWAMUpdates(uint64_t seed = 42) {
+        mt19937 gen(seed);
+        uniform_real_distribution<> dis(50.0, 95.0);
+
+        cout << BOLD << MAGENTA << "\nSimulating WAM updates..." << RESET << endl;
+        
+        for (const auto& student : view()->students) {
+            for (const auto& [course_id, _] : student->copyCourses()) {
+                float new_wam = dis(gen);
+                student->updateWAM(course_id, new_wam);
+                
+                cout << CYAN << "Updated " << student->getName() << "'s " << symbols().name(course_id) 
+                     << " to " << fixed << setprecision(1) << new_wam << RESET << '\n';
+            }
+        }
+        cout << flush;
+    }
+
+    // Drives updateWAM from config.producers threads against the current
+    // enrollments and reports throughput and latency percentiles. Each
+    // producer samples a student, then one of that student's courses, from
+    // its own generator seeded from config.seed. When throttled, latency is
+    // measured from each update's scheduled time so stalls are not hidden.
+    LoadReport generateLoad(const LoadConfig& config) {
+        struct Target {
+            Student* student;
+            vector<SymbolId> courses;
+        };
+        vector<Target> targets;
+        auto v = view(); // keeps the targets alive for the run
+        for (const auto& student : v->students) {
+            vector<SymbolId> enrolled;
+            {
+                lock_guard<mutex> stripe(studentLocks().forKey(student->getHandle()));
+                for (const auto& [course_id, _] : student->getCourses()) enrolled.push_back(course_id);
+            }
+            if (!enrolled.empty()) targets.push_back({student.get(), move(enrolled)});
+        }
+
+        LoadReport report;
+        if (targets.empty() || config.producers == 0 || config.updates_per_producer == 0) return report;
+
+        size_t max_courses = 0;
+        for (const auto& target : targets) max_courses = max(max_courses, target.courses.size());
+        IndexSampler pick_student(config.student_distribution, targets.size(), config.zipf_skew);
+        vector<IndexSampler> pick_course;
+        for (size_t n = 1; n <= max_courses; ++n) pick_course.emplace_back(config.course_distribution, n, config.zipf_skew);
+
+        nanoseconds interval{0};
+        if (config.target_rate > 0) {
+            interval = duration_cast<nanoseconds>(duration<double>(config.producers / config.target_rate));
+        }
+
+        vector<vector<nanoseconds>> update_samples(config.producers), sync_samples(config.producers);
+        vector<thread> producers;
+        auto start = steady_clock::now();
+        for (size_t p = 0; p < config.producers; ++p) {
+            producers.emplace_back([&, p] {
+                seed_seq seq{config.seed, static_cast<uint64_t>(p)};
+                mt19937_64 rng(seq);
+                uniform_real_distribution<float> score(config.min_wam, config.max_wam);
+                auto& latencies = update_samples[p];
+                latencies.reserve(config.updates_per_producer);
+
+                for (size_t i = 0; i < config.updates_per_producer; ++i) {
+                    const Target& target = targets[pick_student(rng)];
+                    SymbolId course_id = target.courses[pick_course[target.courses.size() - 1](rng)];
+                    float wam = score(rng);
+
+                    auto scheduled = steady_clock::now();
+                    if (interval.count() > 0) {
+                        scheduled = start + interval * i;
+                        this_thread::sleep_until(scheduled);
+                    }
+                    target.student->updateWAM(course_id, wam);
+                    auto done = steady_clock::now();
+                    latencies.push_back(duration_cast<nanoseconds>(done - scheduled));
+
+                    if (config.sync_every && (i + 1) % config.sync_every == 0) {
+                        events.sync();
+                        sync_samples[p].push_back(duration_cast<nanoseconds>(steady_clock::now() - done));
+                    }
+                }
+            });
+        }
+        for (auto& producer : producers) producer.join();
+        events.sync();
+        report.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        report.updates = config.producers * config.updates_per_producer;
+
+        auto merge = [](vector<vector<nanoseconds>>& parts) {
+            vector<nanoseconds> all;
+            for (auto& part : parts) all.insert(all.end(), part.begin(), part.end());
+            return all;
+        };
+        auto updates = merge(update_samples);
+        auto syncs = merge(sync_samples);
+        report.update_latency = LatencySummary::from(updates);
+        report.visibility_latency = LatencySummary::from(syncs);
+        return report;
+    }
+
+    // Binary snapshot of the whole college; see the Snapshot section below.
+    // restoreSnapshot requires an empty college.
+    void saveSnapshot(const string& filename) const;
+    void restoreSnapshot(const string& filename);
+
+    // Logs every enrollment, drop and grade to path from now on, appending to
+    // what is already there. Call after recover() and before writers start.
+    void openLog(const string& path, WriteAheadLog::Durability durability = WriteAheadLog::Durability::GROUP_COMMIT) {
+        lock_guard<mutex> lock(mtx);
+        if (wal) throw runtime_error("Log already open: " + wal->getPath());
+        wal = make_unique<WriteAheadLog>(path, durability);
+        for (const auto& student : viewLocked().students) student->attachLog(wal.get());
+    }
+
+    // Startup on an empty college: restores the snapshot if there is one, then
+    // replays log_path and any log_path.next an interrupted checkpoint left.
+    // Returns the number of log records replayed. See the Log Replay section.
+    size_t recover(const string& snapshot_path, const string& log_path);
+
+    // Writes a snapshot and cuts the log back to what it may not cover
+    void checkpoint(const string& snapshot_path);
+
+    // Flat store over the current view, built on first use at each version
+    shared_ptr<const EntityStore> entities() const {
+        auto v = view();
+        lock_guard<mutex> lock(entities_mtx);
+        if (!entity_cache || entity_cache->version() != v->version) {
+            entity_cache = make_shared<const EntityStore>(move(v));
+        }
+        return entity_cache;
+    }
+
+    // Copies of the current view's lists; they share storage with it
+    SegmentedList<Student> getStudents() const { return view()->students; }
+    SegmentedList<Teacher> getTeachers() const { return view()->teachers; }
+    SegmentedList<Course> getCourses() const { return view()->courses; }
+};
+
+// --------------------------
+// Visitor Pattern
+// --------------------------
+
+class Visitor {
+public:
+    virtual ~Visitor() = default;
+    virtual string visit(const Student& student) = 0;
+    virtual string visit(const Teacher& teacher) = 0;
+    virtual string visit(const Course& course) = 0;
+};
+
+// Appends each entity to a caller-owned buffer in the chosen format. Color
+// and Plain match DisplayVisitor's blocks; Csv writes one row per entity,
+// prefixed with its kind; Json writes one object per line. Reuse one buffer
+// across entities and nothing is allocated once it has grown to fit.
+class BufferedDisplayVisitor {
+    string& out;
+    ReportFormat format;
+
+    bool color() const { return format == ReportFormat::Color; }
+
+    void heading(const char* colors, string_view title) {
+        if (color()) out += colors;
+        out += title;
+        if (color()) out += RESET;
+        out += '\n';
+    }
+
+    void line(string_view label, string_view value) {
+        out += label;
+        out += ": ";
+        out += value;
+        out += '\n';
+    }
+
+    void csv(string_view value, bool last = false) {
+        appendCsvField(out, value);
+        out += last ? '\n' : ',';
+    }
+
+    void json(string_view key, string_view value, bool first = false) {
+        out += first ? "{\"" : ",\"";
+        out += key;
+        out += "\":";
+        appendJsonString(out, value);
+    }
+
+    void address(const Person& person) {
+        AddressView a = person.getAddress();
+        out += "Address: ";
+        out += a.street;
+        out += ", ";
+        out += a.city;
+        out += ", ";
+        out += a.state;
+        out += '\n';
+    }
+
+public:
+    explicit BufferedDisplayVisitor(string& out, ReportFormat format = ReportFormat::Color)
+        : out(out), format(format) {}
+
+    // Lets the visitor be passed straight to EntityStore::forEach or visitEntity
+    template <typename T>
+    void operator()(const T& entity) { visit(entity); }
+
+    void visit(const Student& student) {
+        AddressView a = student.getAddress();
+        switch (format) {
+            case ReportFormat::Csv:
+                out += "student,";
+                csv(student.getId()); csv(student.getName()); csv(gradeLevelToString(student.getGradeLevel()));
+                csv(student.getEmail()); csv(a.street); csv(a.city); csv(a.state);
+                appendFixed(out, student.overallWAM(), 1);
+                out += '\n';
+                return;
+            case ReportFormat::Json:
+                json("type", "student", true); json("id", student.getId()); json("name", student.getName());
+                json("grade_level", gradeLevelToString(student.getGradeLevel())); json("email", student.getEmail());
+                json("street", a.street); json("city", a.city); json("state", a.state);
+                out += ",\"wam\":";
+                appendFixed(out, student.overallWAM(), 1);
+                out += "}\n";
+                return;
+            default:
+                heading(BOLD BLUE, "STUDENT");
+                line("Name", student.getName());
+                line("ID", student.getId());
+                line("Grade Level", gradeLevelToString(student.getGradeLevel()));
+                line("Email", student.getEmail());
+                address(student);
+                out += "WAM: ";
+                appendFixed(out, student.overallWAM(), 1);
+                out += '\n';
+        }
+    }
+
+    void visit(const Teacher& teacher) {
+        AddressView a = teacher.getAddress();
+        switch (format) {
+            case ReportFormat::Csv:
+                out += "teacher,";
+                csv(teacher.getId()); csv(teacher.getName()); csv(teacher.getDepartment());
+                csv(teacher.getSpecialization()); csv(teacher.getEmail()); csv(a.street); csv(a.city);
+                csv(a.state, true);
+                return;
+            case ReportFormat::Json:
+                json("type", "teacher", true); json("id", teacher.getId()); json("name", teacher.getName());
+                json("department", teacher.getDepartment()); json("specialization", teacher.getSpecialization());
+                json("email", teacher.getEmail()); json("street", a.street); json("city", a.city);
+                json("state", a.state);
+                out += "}\n";
+                return;
+            default:
+                heading(BOLD GREEN, "TEACHER");
+                line("Name", teacher.getName());
+                line("ID", teacher.getId());
+                line("Department", teacher.getDepartment());
+                line("Specialization", teacher.getSpecialization());
+                line("Email", teacher.getEmail());
+                address(teacher);
+        }
+    }
+
+    void visit(const Course& course) {
+        switch (format) {
+            case ReportFormat::Csv:
+                out += "course,";
+                csv(course.getId()); csv(course.getName());
+                appendInt(out, course.getCredits());
+                out += ',';
+                appendInt(out, course.getEnrolledCount());
+                out += ',';
+                appendInt(out, course.getCapacity());
+                out += '\n';
+                return;
+            case ReportFormat::Json:
+                json("type", "course", true); json("id", course.getId()); json("name", course.getName());
+                out += ",\"credits\":";
+                appendInt(out, course.getCredits());
+                out += ",\"enrolled\":";
+                appendInt(out, course.getEnrolledCount());
+                out += ",\"capacity\":";
+                appendInt(out, course.getCapacity());
+                out += "}\n";
+                return;
+            default:
+                heading(BOLD YELLOW, "COURSE");
+                line("Name", course.getName());
+                line("ID", course.getId());
+                out += "Credits: ";
+                appendInt(out, course.getCredits());
+                out += "\nEnrolled: ";
+                appendInt(out, course.getEnrolledCount());
+                out += '/';
+                appendInt(out, course.getCapacity());
+                out += '\n';
+        }
+    }
+};
+
+// String-returning wrapper over BufferedDisplayVisitor in Color format
+class DisplayVisitor : public Visitor {
+    template <typename T>
+    static string render(const T& entity) {
+        string out;
+        BufferedDisplayVisitor(out).visit(entity);
+        return out;
+    }
+
+public:
+    string visit(const Student& student) override { return render(student); }
+    string visit(const Teacher& teacher) override { return render(teacher); }
+    string visit(const Course& course) override { return render(course); }
+};
+
+// --------------------------
+// File Reading Functions
+// --------------------------
+
+vector<shared_ptr<Student>> readStudentsFromFile(const string& filename) {
+    vector<shared_ptr<Student>> students;
+    auto arena = make_shared<MonotonicArena>();
+    ifstream file(filename);
+    if (!file.is_open()) {
+        throw runtime_error("Could not open file: " + filename);
+    }
+
+    string line;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string token;
+        vector<string> tokens;
+
+        while (getline(ss, token, ',')) {
+            // Trim whitespace from token
+            token.erase(0, token.find_first_not_of(" \t\n\r\f\v"));
+            token.erase(token.find_last_not_of(" \t\n\r\f\v") + 1);
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() != 8) {
+            countMetric(Counter::PARSE_ERRORS);
+            cerr << RED << "Invalid student record: " << line << RESET << endl;
+            continue;
+        }
+
+        AddressView addr{tokens[3], tokens[4], tokens[5], tokens[6]};
+        students.push_back(makeInArena<Student>(arena,
+            tokens[0], tokens[1], tokens[2], addr, stringToGradeLevel(tokens[7]), arena
+        ));
+    }
+
+    return students;
+}
+
+vector<shared_ptr<Teacher>> readTeachersFromFile(const string& filename) {
+    vector<shared_ptr<Teacher>> teachers;
+    auto arena = make_shared<MonotonicArena>();
+    ifstream file(filename);
+    if (!file.is_open()) {
+        throw runtime_error("Could not open file: " + filename);
+    }
+
+    string line;
+    while (getline(file, line)) {
+        stringstream ss(line);
+        string token;
+        vector<string> tokens;
+
+        while (getline(ss, token, ',')) {
+            // Trim whitespace from token
+            token.erase(0, token.find_first_not_of(" \t\n\r\f\v"));
+            token.erase(token.find_last_not_of(" \t\n\r\f\v") + 1);
+            tokens.push_back(token);
+        }
+
+        if (tokens.size() != 9) {
+            countMetric(Counter::PARSE_ERRORS);
+            cerr << RED << "Invalid teacher record: " << line << RESET << endl;
+            continue;
+        }
+
+        AddressView addr{tokens[3], tokens[4], tokens[5], tokens[6]};
+        teachers.push_back(makeInArena<Teacher>(arena,
+            tokens[0], tokens[1], tokens[2], addr, tokens[7], tokens[8], arena
+        ));
+    }
+
+    return teachers;
+}
+
+// --------------------------
+// Memory-Mapped Loader
+// --------------------------
+
+enum class LoadMode { Stream, Mapped, Parallel };
+
+// Read-only mapping of a whole file; empty files map to an empty view
+class MappedFile {
+    const char* data = nullptr;
+    size_t length = 0;
+
+public:
+    explicit MappedFile(const string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw runtime_error("Could not open file: " + filename);
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw runtime_error("Could not stat file: " + filename);
+        }
+        length = st.st_size;
+        if (length > 0) {
+            void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                throw runtime_error("Could not map file: " + filename);
+            }
+            madvise(p, length, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(p);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), length);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    string_view view() const { return {data, length}; }
+};
+
+// First ',' or '\n' in [p, end), or end
+inline const char* findDelimiter(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, comma), _mm_cmpeq_epi8(chunk, newline)));
+        if (mask) return p + __builtin_ctz(mask);
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == ',' || *p == '\n') return p;
+    }
+    return end;
+}
+
+inline string_view trimField(string_view field) {
+    constexpr string_view ws = " \t\n\r\f\v";
+    size_t first = field.find_first_not_of(ws);
+    if (first == string_view::npos) return {};
+    return field.substr(first, field.find_last_not_of(ws) - first + 1);
+}
+
+// Splits text into lines of exactly N comma-separated fields. Each valid row is
+// handed to on_record as trimmed views into text; rows with the wrong field
+// count go to on_error with their 1-based line number (counted from first_line).
+// One trailing empty field (a row ending in a comma) is ignored, as the old
+// getline loader did. Returns the number of lines consumed.
+template <size_t N, typename OnRecord, typename OnError>
+size_t parseRecords(string_view text, size_t first_line, OnRecord on_record, OnError on_error) {
+    const char* p = text.data();
+    const char* end = p + text.size();
+    size_t line_no = first_line;
+    array<string_view, N> fields;
+
+    while (p < end) {
+        const char* line_start = p;
+        const char* line_end = nullptr;
+        size_t n = 0;
+        bool trailing_empty = false;
+        while (!line_end) {
+            const char* d = findDelimiter(p, end);
+            string_view field = trimField(string_view(p, d - p));
+            if (n < N) fields[n] = field;
+            else if (n == N) trailing_empty = field.empty();
+            n++;
+            if (d == end || *d == '\n') line_end = d;
+            p = (d == end) ? end : d + 1;
+        }
+
+        string_view line(line_start, line_end - line_start);
+        if (n == N || (n == N + 1 && trailing_empty)) {
+            on_record(fields, line_no);
+        } else {
+            countMetric(Counter::PARSE_ERRORS);
+            on_error(line, line_no);
+        }
+        line_no++;
+    }
+    return line_no - first_line;
+}
+
+// Arena for entities parsed from `bytes` of roster text; objects plus their
+// copied fields come to roughly three times the input
+shared_ptr<MonotonicArena> loadArena(size_t bytes) {
+    return make_shared<MonotonicArena>(bytes * 3 + 4096);
+}
+
+shared_ptr<Student> buildStudent(const array<string_view, 8>& f, const shared_ptr<MonotonicArena>& arena) {
+    return makeInArena<Student>(arena, f[0], f[1], f[2], AddressView{f[3], f[4], f[5], f[6]},
+                                stringToGradeLevel(f[7]), arena);
+}
+
+shared_ptr<Teacher> buildTeacher(const array<string_view, 9>& f, const shared_ptr<MonotonicArena>& arena) {
+    return makeInArena<Teacher>(arena, f[0], f[1], f[2], AddressView{f[3], f[4], f[5], f[6]}, f[7], f[8], arena);
+}
+
+vector<shared_ptr<Student>> readStudentsMapped(const string& filename) {
+    MappedFile file(filename);
+    auto arena = loadArena(file.view().size());
+    vector<shared_ptr<Student>> students;
+    parseRecords<8>(file.view(), 1,
+        [&](const array<string_view, 8>& f, size_t) {
+            students.push_back(buildStudent(f, arena));
+        },
+        [](string_view line, size_t line_no) {
+            cerr << RED << "Invalid student record at line " << line_no << ": " << line << RESET << endl;
+        });
+    return students;
+}
+
+vector<shared_ptr<Teacher>> readTeachersMapped(const string& filename) {
+    MappedFile file(filename);
+    auto arena = loadArena(file.view().size());
+    vector<shared_ptr<Teacher>> teachers;
+    parseRecords<9>(file.view(), 1,
+        [&](const array<string_view, 9>& f, size_t) {
+            teachers.push_back(buildTeacher(f, arena));
+        },
+        [](string_view line, size_t line_no) {
+            cerr << RED << "Invalid teacher record at line " << line_no << ": " << line << RESET << endl;
+        });
+    return teachers;
+}
+
+// --------------------------
+// Parallel Chunked Loader
+// --------------------------
+
+// Splits text into at most `parts` chunks, each ending just after a newline
+// (except possibly the last), so no record straddles two chunks
+vector<string_view> splitAtLines(string_view text, size_t parts) {
+    vector<string_view> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i < parts && begin < text.size(); ++i) {
+        size_t target = max(begin, text.size() * i / parts);
+        size_t nl = text.find('\n', target);
+        if (nl == string_view::npos) break;
+        chunks.push_back(text.substr(begin, nl + 1 - begin));
+        begin = nl + 1;
+    }
+    if (begin < text.size()) chunks.push_back(text.substr(begin));
+    return chunks;
+}
+
+// Parses each chunk as a task on the pool into a chunk-local vector and arena,
+// then concatenates them in source order. Bad rows are collected per chunk and
+// reported afterwards with their global line numbers, so output stays ordered.
+template <size_t N, typename T, typename Build>
+vector<shared_ptr<T>> readParallel(const string& filename, unsigned threads, const char* kind, Build build) {
+    constexpr size_t MIN_CHUNK_BYTES = 64 * 1024;
+
+    struct ChunkResult {
+        vector<shared_ptr<T>> records;
+        vector<pair<size_t, string>> errors; // chunk-relative line, raw line
+        size_t lines = 0;
+    };
+
+    MappedFile file(filename);
+    string_view text = file.view();
+    size_t parts = clamp<size_t>(text.size() / MIN_CHUNK_BYTES, 1, max(1u, threads));
+    auto chunks = splitAtLines(text, parts);
+
+    vector<ChunkResult> results(chunks.size());
+    defaultPool().parallelFor(chunks.size(), 1, [&](size_t c, size_t) {
+        string_view chunk = chunks[c];
+        ChunkResult& result = results[c];
+        auto arena = loadArena(chunk.size());
+        // ~60 bytes per roster line is a fair first guess
+        result.records.reserve(chunk.size() / 60 + 1);
+        result.lines = parseRecords<N>(chunk, 1,
+            [&](const array<string_view, N>& f, size_t) { result.records.push_back(build(f, arena)); },
+            [&](string_view line, size_t line_no) { result.errors.emplace_back(line_no, string(line)); });
+    });
+
+    size_t total = 0;
+    for (const auto& r : results) total += r.records.size();
+
+    vector<shared_ptr<T>> merged;
+    merged.reserve(total);
+    size_t line_offset = 0;
+    for (auto& r : results) {
+        for (const auto& [line_no, line] : r.errors) {
+            cerr << RED << "Invalid " << kind << " record at line " << line_offset + line_no << ": " << line << RESET << endl;
+        }
+        move(r.records.begin(), r.records.end(), back_inserter(merged));
+        line_offset += r.lines;
+    }
+    return merged;
+}
+
+vector<shared_ptr<Student>> readStudentsParallel(const string& filename, unsigned threads = thread::hardware_concurrency()) {
+    return readParallel<8, Student>(filename, threads, "student", buildStudent);
+}
+
+vector<shared_ptr<Teacher>> readTeachersParallel(const string& filename, unsigned threads = thread::hardware_concurrency()) {
+    return readParallel<9, Teacher>(filename, threads, "teacher", buildTeacher);
+}
+
+vector<shared_ptr<Student>> readStudentsFromFile(const string& filename, LoadMode mode) {
+    SCOPED_TIMER(Metric::FILE_PARSE);
+    vector<shared_ptr<Student>> students;
+    switch (mode) {
+        case LoadMode::Mapped: students = readStudentsMapped(filename); break;
+        case LoadMode::Parallel: students = readStudentsParallel(filename); break;
+        default: students = readStudentsFromFile(filename); break;
+    }
+    countMetric(Counter::ROWS_PARSED, students.size());
+    return students;
+}
+
+vector<shared_ptr<Teacher>> readTeachersFromFile(const string& filename, LoadMode mode) {
+    SCOPED_TIMER(Metric::FILE_PARSE);
+    vector<shared_ptr<Teacher>> teachers;
+    switch (mode) {
+        case LoadMode::Mapped: teachers = readTeachersMapped(filename); break;
+        case LoadMode::Parallel: teachers = readTeachersParallel(filename); break;
+        default: teachers = readTeachersFromFile(filename); break;
+    }
+    countMetric(Counter::ROWS_PARSED, teachers.size());
+    return teachers;
+}
+
+// --------------------------
+// Delta Files
+// --------------------------
+
+// One change per line, applied in file order:
+//   +,<roster row>   insert, or update the entity with that id
+//   -,<id>           delete
+// Blank lines are skipped; anything else is reported and ignored.
+template <size_t N, typename T, typename Build>
+RosterDelta<T> readDelta(const string& filename, const char* kind, Build build) {
+    SCOPED_TIMER(Metric::FILE_PARSE);
+    MappedFile file(filename);
+    RosterDelta<T> delta;
+    delta.arena = loadArena(file.view().size());
+    auto reject = [kind](string_view line, size_t line_no) {
+        cerr << RED << "Invalid " << kind << " delta at line " << line_no << ": " << line << RESET << endl;
+    };
+
+    string_view text = file.view();
+    for (size_t line_no = 1; !text.empty(); ++line_no) {
+        size_t nl = text.find('\n');
+        string_view line = text.substr(0, nl);
+        text = nl == string_view::npos ? string_view() : text.substr(nl + 1);
+
+        size_t comma = line.find(',');
+        string_view op = trimField(line.substr(0, comma));
+        string_view rest = comma == string_view::npos ? string_view() : line.substr(comma + 1);
+        if (op == "+") {
+            parseRecords<N>(rest, line_no,
+                [&](const array<string_view, N>& f, size_t) { delta.upserts.push_back(build(f, delta.arena)); },
+                [&](string_view, size_t) { reject(line, line_no); });
+        } else if (op == "-" && rest.find(',') == string_view::npos && !trimField(rest).empty()) {
+            delta.deletes.push_back(delta.arena->copy(trimField(rest)));
+        } else if (!trimField(line).empty()) {
+            countMetric(Counter::PARSE_ERRORS);
+            reject(line, line_no);
+        }
+    }
+    countMetric(Counter::ROWS_PARSED, delta.upserts.size() + delta.deletes.size());
+    return delta;
+}
+
+RosterDelta<Student> readStudentDelta(const string& filename) {
+    return readDelta<8, Student>(filename, "student", buildStudent);
+}
+
+RosterDelta<Teacher> readTeacherDelta(const string& filename) {
+    return readDelta<9, Teacher>(filename, "teacher", buildTeacher);
+}
+
+// --------------------------
+// Binary Snapshot
+// --------------------------
+
+// Layout (host byte order, every section 4-byte aligned):
+//   SnapshotHeader
+//   uint32_t string_offsets[string_count + 1]   into the blob
+//   char     blob[blob_bytes]                    padded to 4 bytes
+//   StudentRecord[], TeacherRecord[], CourseRecord[],
+//   EnrollmentRecord[], MemberRecord[], PrerequisiteRecord[], AssignmentRecord[]
+// Every string field is an index into the string table; entity references are
+// slots in the corresponding record array.
+
+constexpr char SNAPSHOT_MAGIC[8] = {'C', 'L', 'G', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t string_count;
+    uint32_t blob_bytes;
+    uint32_t college_name;
+    uint32_t student_count;
+    uint32_t teacher_count;
+    uint32_t course_count;
+    uint32_t enrollment_count;
+    uint32_t member_count;
+    uint32_t prerequisite_count;
+    uint32_t assignment_count;
+    uint32_t reserved;
+};
+
+struct StudentRecord { uint32_t id, name, email, street, city, state, zip, grade_level; };
+struct TeacherRecord { uint32_t id, name, email, street, city, state, zip, department, specialization; };
+struct CourseRecord { uint32_t id, name; int32_t credits, capacity; };
+struct EnrollmentRecord { uint32_t student, course_id, has_score; float score; }; // Student::courses
+struct MemberRecord { uint32_t course, student_id; };                          // Course::enrolled_students
+struct PrerequisiteRecord { uint32_t course, prerequisite_id; };
+struct AssignmentRecord { uint32_t teacher, course_id; };
+
+// Deduplicating string table used while writing
+class StringTableBuilder {
+    unordered_map<string_view, uint32_t> ids;
+    vector<uint32_t> offsets{0};
+    string blob;
+
+public:
+    uint32_t intern(string_view str) {
+        auto it = ids.find(str);
+        if (it != ids.end()) return it->second;
+        // Keys view the source entities, which outlive the builder
+        uint32_t id = offsets.size() - 1;
+        blob.append(str);
+        if (blob.size() > UINT32_MAX) throw runtime_error("Snapshot string table too large");
+        offsets.push_back(blob.size());
+        ids.emplace(str, id);
+        return id;
+    }
+
+    uint32_t count() const { return offsets.size() - 1; }
+    const vector<uint32_t>& getOffsets() const { return offsets; }
+    const string& getBlob() const { return blob; }
+};
+
+template <typename T>
+void writePod(ofstream& out, const vector<T>& records) {
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T));
+}
+
+void College::saveSnapshot(const string& filename) const {
+    lock_guard<mutex> lock(mtx);
+    const CollegeView& v = viewLocked();
+    const auto& students = v.students;
+    const auto& teachers = v.teachers;
+    const auto& courses = v.courses;
+    StringTableBuilder strings;
+    auto addr = [&](const AddressView& a) {
+        return array<uint32_t, 4>{strings.intern(a.street), strings.intern(a.city),
+                                  strings.intern(a.state), strings.intern(a.zip_code)};
+    };
+
+    vector<StudentRecord> student_records;
+    vector<EnrollmentRecord> enrollments;
+    student_records.reserve(students.size());
+    for (size_t i = 0; i < students.size(); ++i) {
+        const auto& s = *students[i];
+        auto a = addr(s.getAddress());
+        student_records.push_back({strings.intern(s.getId()), strings.intern(s.getName()), strings.intern(s.getEmail()),
+                                   a[0], a[1], a[2], a[3], static_cast<uint32_t>(s.getGradeLevel())});
+        for (const auto& [course_id, wam] : s.copyCourses()) {
+            enrollments.push_back({static_cast<uint32_t>(i), strings.intern(symbols().name(course_id)),
+                                   wam.has_value(), wam.value_or(0.0f)});
+        }
+    }
+
+    vector<TeacherRecord> teacher_records;
+    vector<AssignmentRecord> assignments;
+    teacher_records.reserve(teachers.size());
+    for (size_t i = 0; i < teachers.size(); ++i) {
+        const auto& t = *teachers[i];
+        auto a = addr(t.getAddress());
+        teacher_records.push_back({strings.intern(t.getId()), strings.intern(t.getName()), strings.intern(t.getEmail()),
+                                   a[0], a[1], a[2], a[3],
+                                   strings.intern(t.getDepartment()), strings.intern(t.getSpecialization())});
+        for (const auto& course_id : t.getAssignedCourses()) {
+            assignments.push_back({static_cast<uint32_t>(i), strings.intern(symbols().name(course_id))});
+        }
+    }
+
+    vector<CourseRecord> course_records;
+    vector<MemberRecord> members;
+    vector<PrerequisiteRecord> prerequisites;
+    course_records.reserve(courses.size());
+    for (size_t i = 0; i < courses.size(); ++i) {
+        const auto& c = *courses[i];
+        course_records.push_back({strings.intern(c.getId()), strings.intern(c.getName()), c.getCredits(), c.getCapacity()});
+        for (const auto& student_id : c.getEnrolledStudents()) {
+            members.push_back({static_cast<uint32_t>(i), strings.intern(symbols().name(student_id))});
+        }
+        for (const auto& prereq : c.getPrerequisites()) {
+            prerequisites.push_back({static_cast<uint32_t>(i), strings.intern(symbols().name(prereq))});
+        }
+    }
+
+    SnapshotHeader header{};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.college_name = strings.intern(name);
+    header.string_count = strings.count();
+    header.blob_bytes = strings.getBlob().size();
+    header.student_count = student_records.size();
+    header.teacher_count = teacher_records.size();
+    header.course_count = course_records.size();
+    header.enrollment_count = enrollments.size();
+    header.member_count = members.size();
+    header.prerequisite_count = prerequisites.size();
+    header.assignment_count = assignments.size();
+
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        throw runtime_error("Could not open file: " + filename);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writePod(out, strings.getOffsets());
+    out.write(strings.getBlob().data(), strings.getBlob().size());
+    static const char padding[4] = {};
+    out.write(padding, (4 - strings.getBlob().size() % 4) % 4);
+    writePod(out, student_records);
+    writePod(out, teacher_records);
+    writePod(out, course_records);
+    writePod(out, enrollments);
+    writePod(out, members);
+    writePod(out, prerequisites);
+    writePod(out, assignments);
+    if (!out) {
+        throw runtime_error("Failed writing snapshot: " + filename);
+    }
+}
+
+// Bounds-checked cursor over a mapped snapshot
+class SnapshotReader {
+    string_view data;
+    size_t pos = 0;
+
+public:
+    explicit SnapshotReader(string_view data) : data(data) {}
+
+    const char* take(size_t bytes) {
+        if (bytes > data.size() - pos) throw runtime_error("Corrupt snapshot: truncated");
+        const char* p = data.data() + pos;
+        pos += bytes;
+        return p;
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        memcpy(&value, take(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    vector<T> readArray(size_t count) {
+        if (count > (data.size() - pos) / sizeof(T)) throw runtime_error("Corrupt snapshot: truncated");
+        vector<T> values(count);
+        if (count) memcpy(values.data(), take(count * sizeof(T)), count * sizeof(T));
+        return values;
+    }
+};
+
+void College::restoreSnapshot(const string& filename) {
+    MappedFile file(filename);
+    SnapshotReader reader(file.view());
+
+    auto header = reader.read<SnapshotHeader>();
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0) {
+        throw runtime_error("Not a college snapshot: " + filename);
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        throw runtime_error("Unsupported snapshot version " + to_string(header.version) + ": " + filename);
+    }
+
+    auto offsets = reader.readArray<uint32_t>(size_t(header.string_count) + 1);
+    string_view blob(reader.take(header.blob_bytes), header.blob_bytes);
+    reader.take((4 - header.blob_bytes % 4) % 4);
+    auto str = [&](uint32_t id) -> string_view {
+        if (id >= header.string_count || offsets[id] > offsets[id + 1] || offsets[id + 1] > blob.size()) {
+            throw runtime_error("Corrupt snapshot: bad string reference");
+        }
+        return blob.substr(offsets[id], offsets[id + 1] - offsets[id]);
+    };
+    auto check = [](uint32_t slot, size_t count) {
+        if (slot >= count) throw runtime_error("Corrupt snapshot: bad entity reference");
+        return slot;
+    };
+
+    auto student_records = reader.readArray<StudentRecord>(header.student_count);
+    auto teacher_records = reader.readArray<TeacherRecord>(header.teacher_count);
+    auto course_records = reader.readArray<CourseRecord>(header.course_count);
+    auto enrollments = reader.readArray<EnrollmentRecord>(header.enrollment_count);
+    auto members = reader.readArray<MemberRecord>(header.member_count);
+    auto prerequisites = reader.readArray<PrerequisiteRecord>(header.prerequisite_count);
+    auto assignments = reader.readArray<AssignmentRecord>(header.assignment_count);
+
+    // One arena for every restored entity, sized from the string blob
+    auto arena = make_shared<MonotonicArena>(blob.size() +
+        student_records.size() * 256 + teacher_records.size() * 256 + course_records.size() * 1024 + 4096);
+
+    vector<shared_ptr<Student>> new_students;
+    new_students.reserve(student_records.size());
+    for (const auto& r : student_records) {
+        if (r.grade_level > static_cast<uint32_t>(GradeLevel::SENIOR)) {
+            throw runtime_error("Corrupt snapshot: bad grade level");
+        }
+        new_students.push_back(makeInArena<Student>(arena,
+            str(r.id), str(r.name), str(r.email),
+            AddressView{str(r.street), str(r.city), str(r.state), str(r.zip)},
+            static_cast<GradeLevel>(r.grade_level), arena));
+    }
+    for (const auto& e : enrollments) {
+        auto& student = new_students[check(e.student, new_students.size())];
+        SymbolId course_id = symbols().intern(str(e.course_id));
+        student->enroll(course_id);
+        if (e.has_score) student->updateWAM(course_id, e.score);
+    }
+
+    vector<shared_ptr<Teacher>> new_teachers;
+    new_teachers.reserve(teacher_records.size());
+    for (const auto& r : teacher_records) {
+        new_teachers.push_back(makeInArena<Teacher>(arena,
+            str(r.id), str(r.name), str(r.email),
+            AddressView{str(r.street), str(r.city), str(r.state), str(r.zip)},
+            str(r.department), str(r.specialization), arena));
+    }
+    for (const auto& a : assignments) {
+        new_teachers[check(a.teacher, new_teachers.size())]->assignCourse(str(a.course_id));
+    }
+
+    vector<shared_ptr<Course>> new_courses;
+    new_courses.reserve(course_records.size());
+    for (const auto& r : course_records) {
+        new_courses.push_back(makeInArena<Course>(arena, str(r.id), string(str(r.name)), r.credits, r.capacity));
+    }
+    for (const auto& m : members) {
+        if (!new_courses[check(m.course, new_courses.size())]->restoreStudent(symbols().intern(str(m.student_id)))) {
+            throw runtime_error("Corrupt snapshot: duplicate roster entry");
+        }
+    }
+    for (const auto& p : prerequisites) {
+        new_courses[check(p.course, new_courses.size())]->addPrerequisite(str(p.prerequisite_id));
+    }
+
+    {
+        lock_guard<mutex> lock(mtx);
+        const CollegeView& v = viewLocked();
+        if (!v.students.empty() || !v.teachers.empty() || !v.courses.empty()) {
+            throw runtime_error("restoreSnapshot requires an empty college");
+        }
+        name = string(str(header.college_name));
+    }
+    addStudents(move(new_students));
+    addTeachers(move(new_teachers));
+    addCourses(move(new_courses));
+    if (!prerequisites.empty()) buildPrerequisiteGraph();
+}
+
+// --------------------------
+// Log Replay and Checkpoints
+// --------------------------
+
+size_t WriteAheadLog::replay(const string& filename, const function<void(const LogEntry&)>& apply) {
+    if (::access(filename.c_str(), F_OK) != 0) return 0;
+    MappedFile file(filename);
+    string_view data = file.view();
+    size_t records = 0;
+    while (!data.empty()) {
+        LogRecordHeader header{};
+        bool intact = data.size() >= sizeof(header);
+        if (intact) memcpy(&header, data.data(), sizeof(header));
+        size_t size = sizeof(header) + header.student_len + header.course_len;
+        intact = intact && size <= data.size() &&
+                 logChecksum(data.data() + sizeof(uint32_t), size - sizeof(uint32_t)) == header.checksum;
+        if (!intact) {
+            cerr << RED << "Log " << filename << " ends in a torn record; ignoring the tail" << RESET << endl;
+            break;
+        }
+        string_view ids = data.substr(sizeof(header), header.student_len + header.course_len);
+        apply(LogEntry{header.op, ids.substr(0, header.student_len), ids.substr(header.student_len),
+                       header.has_score ? optional<float>(header.score) : nullopt});
+        data.remove_prefix(size);
+        records++;
+    }
+    return records;
+}
+
+// fsync for a file written through a stream, or for a directory after a rename
+void syncPath(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw runtime_error("Could not open for sync: " + path);
+    }
+    int rc = ::fsync(fd);
+    ::close(fd);
+    if (rc != 0) {
+        throw runtime_error("Could not sync: " + path);
+    }
+}
+
+string parentDirectory(const string& path) {
+    size_t slash = path.rfind('/');
+    if (slash == string::npos) return ".";
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+size_t College::recover(const string& snapshot_path, const string& log_path) {
+    if (wal) {
+        throw runtime_error("recover must run before openLog");
+    }
+    if (::access(snapshot_path.c_str(), F_OK) == 0) restoreSnapshot(snapshot_path);
+
+    auto pin = view();
+    size_t skipped = 0;
+    auto apply = [&](const LogEntry& entry) {
+        Student* student = student_index.findRaw(entry.student_id);
+        Course* course = course_index.findRaw(entry.course_id);
+        if (!student || !course) {
+            skipped++;
+            return;
+        }
+        switch (entry.op) {
+            case LogOp::ENROLL:
+                course->restoreStudent(student->getHandle());
+                student->enroll(course->getHandle());
+                break;
+            case LogOp::DROP:
+                course->dropStudent(student->getHandle());
+                student->drop(course->getHandle());
+                break;
+            case LogOp::GRADE:
+                if (entry.score) student->updateWAM(course->getHandle(), *entry.score);
+                break;
+            default:
+                skipped++;
+                break;
+        }
+    };
+    string next_path = log_path + ".next";
+    size_t replayed = WriteAheadLog::replay(log_path, apply) + WriteAheadLog::replay(next_path, apply);
+    if (skipped) {
+        cerr << RED << "Skipped " << skipped << " log records for unknown students or courses" << RESET << endl;
+    }
+    // A checkpoint died between its two halves. Finish it here: new records
+    // appended to log_path would otherwise replay before the ".next" ones.
+    if (::access(next_path.c_str(), F_OK) == 0) {
+        checkpoint(snapshot_path);
+        ::unlink(next_path.c_str());
+        ::unlink(log_path.c_str());
+        syncPath(parentDirectory(log_path));
+    }
+    return replayed;
+}
+
+// The log is rotated first, so every record in the old file describes a change
+// already applied in memory and therefore in the snapshot. Records that land in
+// the new file during the snapshot may or may not be in it; replaying them is
+// harmless. A crash at any step leaves a snapshot plus logs that recover()
+// turns back into the same state.
+void College::checkpoint(const string& snapshot_path) {
+    if (wal) wal->rotate();
+    string tmp = snapshot_path + ".tmp";
+    saveSnapshot(tmp);
+    syncPath(tmp);
+    if (::rename(tmp.c_str(), snapshot_path.c_str()) != 0) {
+        throw runtime_error("Could not replace snapshot: " + snapshot_path);
+    }
+    syncPath(parentDirectory(snapshot_path));
+    if (wal) {
+        wal->commitRotation();
+        syncPath(parentDirectory(wal->getPath()));
+    }
+}
+
+// --------------------------
+// Sharding
+// --------------------------
+
+// Partitions one logical college across shard Colleges: students and
+// teachers by a hash of their id, courses by a hash of theirs. Every shard
+// also holds an uncapped replica of every course, so the student half of an
+// enrollment, grading and prerequisite checks stay local to the student's
+// shard; the owning shard's copy alone counts seats. Each call below makes
+// at most one request of each shard involved, so a shard can sit behind a
+// RequestServer on another node without changing the routing.
+//
+// Log recovery is not supported for shards: the seat a course's owner holds
+// for a student on another shard (reserveSeat) is not in any log, so
+// openLog/recover on a shard would bring rosters back short. Rebuild a
+// sharded college from its sources instead.
+class ShardedCollege {
+    static constexpr uint32_t SHARD_SEED = 0x5eed;
+
+    vector<unique_ptr<College>> shards;
+
+    // Cross-shard enrollment: check the student where they live, reserve the
+    // seat where the course lives, then record it with the student, giving
+    // the seat back if a racing change makes that fail
+    EnrollStatus enrollAcross(College& home, College& owner, string_view student_id, string_view course_id) {
+        EnrollStatus status = home.checkEnrollment(student_id, course_id);
+        if (status == EnrollStatus::OK) status = owner.reserveSeat(student_id, course_id);
+        if (status != EnrollStatus::OK) return status;
+        string course(course_id);
+        status = home.registerForCourses(student_id, span<const string>(&course, 1));
+        if (status != EnrollStatus::OK) owner.releaseSeat(student_id, course_id);
+        return status;
+    }
+
+    // Runs body(shard index) on every shard in parallel
+    template <typename Body>
+    void scatter(Body body) const {
+        defaultPool().parallelFor(shards.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) body(i);
+        });
+    }
+
+    // Grades for a course are recorded on every student's shard, so each
+    // shard has to learn the course's department, not just the teacher's
+    void linkElsewhere(size_t home, string_view course_id, string_view department) {
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (i != home) shards[i]->linkCourseDepartment(course_id, department);
+        }
+    }
+
+    // Splits entities by owning shard and adds each part in parallel
+    template <typename T, typename Add>
+    void distribute(vector<shared_ptr<T>>&& batch, Add add) {
+        vector<vector<shared_ptr<T>>> parts(shards.size());
+        for (auto& entity : batch) parts[shardOf(entity->getId())].push_back(move(entity));
+        scatter([&](size_t i) {
+            if (!parts[i].empty()) add(*shards[i], move(parts[i]));
+        });
+    }
+
+public:
+    ShardedCollege(const string& name, size_t shard_count) {
+        if (shard_count == 0) throw runtime_error("ShardedCollege needs at least one shard");
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards.push_back(make_unique<College>(name + " #" + to_string(i)));
+        }
+    }
+
+    // Stable across processes and builds, unlike std::hash
+    size_t shardOf(string_view id) const { return perfectHashKey(id, SHARD_SEED) % shards.size(); }
+    College& shard(size_t i) { return *shards[i]; }
+    const College& shard(size_t i) const { return *shards[i]; }
+    size_t shardCount() const { return shards.size(); }
+
+    void addStudents(vector<shared_ptr<Student>>&& batch) {
+        distribute(move(batch), [](College& shard, auto&& part) { shard.addStudents(move(part)); });
+    }
+
+    void addTeachers(vector<shared_ptr<Teacher>>&& batch) {
+        vector<shared_ptr<Teacher>> teaching;
+        for (const auto& teacher : batch) {
+            if (teacher->courseLoad() > 0) teaching.push_back(teacher);
+        }
+        distribute(move(batch), [](College& shard, auto&& part) { shard.addTeachers(move(part)); });
+        for (const auto& teacher : teaching) {
+            for (SymbolId course_id : teacher->getAssignedCourses()) {
+                linkElsewhere(shardOf(teacher->getId()), symbols().name(course_id), teacher->getDepartment());
+            }
+        }
+    }
+
+    // The course goes to its owning shard; the others get a replica
+    void addCourse(shared_ptr<Course> course) {
+        size_t owner = shardOf(course->getId());
+        for (size_t i = 0; i < shards.size(); ++i) {
+            if (i == owner) continue;
+            auto replica = make_shared<Course>(course->getId(), course->getName(), course->getCredits(), INT_MAX);
+            for (SymbolId prereq : course->getPrerequisites()) replica->addPrerequisite(prereq);
+            shards[i]->addCourse(move(replica));
+        }
+        shards[owner]->addCourse(move(course));
+    }
+
+    void buildPrerequisiteGraph() {
+        for (auto& shard : shards) shard->buildPrerequisiteGraph();
+    }
+
+    void assignCourse(Teacher& teacher, string_view course_id) {
+        size_t home = shardOf(teacher.getId());
+        shards[home]->assignCourse(teacher, course_id);
+        linkElsewhere(home, course_id, teacher.getDepartment());
+    }
+
+    shared_ptr<Student> findStudent(string_view id) const { return shards[shardOf(id)]->findStudent(id); }
+    shared_ptr<Teacher> findTeacher(string_view id) const { return shards[shardOf(id)]->findTeacher(id); }
+
+    // The owner's copy, which holds the real seat counts
+    shared_ptr<Course> findCourse(string_view id) const { return shards[shardOf(id)]->findCourse(id); }
+
+    EnrollStatus enroll(string_view student_id, string_view course_id) {
+        College& home = *shards[shardOf(student_id)];
+        College& owner = *shards[shardOf(course_id)];
+        if (&home == &owner) {
+            string course(course_id);
+            return home.registerForCourses(student_id, span<const string>(&course, 1));
+        }
+        return enrollAcross(home, owner, student_id, course_id);
+    }
+
+    bool drop(string_view student_id, string_view course_id) {
+        College& home = *shards[shardOf(student_id)];
+        College& owner = *shards[shardOf(course_id)];
+        if (!home.dropStudentFromCourse(student_id, course_id)) return false;
+        if (&home != &owner) owner.releaseSeat(student_id, course_id);
+        return true;
+    }
+
+    bool updateWAM(string_view student_id, string_view course_id, float wam) {
+        auto student = findStudent(student_id);
+        if (!student) return false;
+        student->updateWAM(course_id, wam);
+        return true;
+    }
+
+    // Rows whose student and course share a shard go through that shard's
+    // enrollBatch, all shards at once; the rest take the two-step path on the pool
+    BatchEnrollResult enrollBatch(span<const pair<string, string>> rows) {
+        auto start = steady_clock::now();
+        BatchEnrollResult result;
+        result.statuses.assign(rows.size(), EnrollStatus::NOT_FOUND);
+
+        vector<vector<pair<string, string>>> local(shards.size());
+        vector<vector<size_t>> local_rows(shards.size());
+        vector<size_t> across;
+        for (size_t i = 0; i < rows.size(); ++i) {
+            size_t home = shardOf(rows[i].first);
+            if (home == shardOf(rows[i].second)) {
+                local[home].push_back(rows[i]);
+                local_rows[home].push_back(i);
+            } else {
+                across.push_back(i);
+            }
+        }
+
+        atomic<size_t> enrolled{0};
+        scatter([&](size_t s) {
+            if (local[s].empty()) return;
+            auto batch = shards[s]->enrollBatch(local[s]);
+            for (size_t k = 0; k < local_rows[s].size(); ++k) result.statuses[local_rows[s][k]] = batch.statuses[k];
+            enrolled += batch.enrolled;
+        });
+        defaultPool().parallelFor(across.size(), 256, [&](size_t begin, size_t end) {
+            size_t seated = 0;
+            for (size_t k = begin; k < end; ++k) {
+                const auto& [student_id, course_id] = rows[across[k]];
+                EnrollStatus status = enrollAcross(*shards[shardOf(student_id)], *shards[shardOf(course_id)],
+                                                   student_id, course_id);
+                result.statuses[across[k]] = status;
+                seated += status == EnrollStatus::OK;
+            }
+            enrolled += seated;
+        });
+        result.enrolled = enrolled;
+        result.elapsed = duration_cast<nanoseconds>(steady_clock::now() - start);
+        return result;
+    }
+
+    // Each shard's top n, merged: the global top n is among them. Shards and
+    // merge break ties on the student handle, so the order matches one College.
+    vector<pair<string, float>> getTopPerformers(int n) const {
+        if (n <= 0) return {};
+        vector<vector<tuple<SymbolId, string, float>>> partial(shards.size());
+        scatter([&](size_t i) { partial[i] = shards[i]->getRankedPerformers(n); });
+        vector<tuple<SymbolId, string, float>> merged;
+        for (auto& part : partial) move(part.begin(), part.end(), back_inserter(merged));
+        size_t k = min(merged.size(), size_t(n));
+        partial_sort(merged.begin(), merged.begin() + k, merged.end(),
+            [](const auto& a, const auto& b) {
+                return get<2>(a) != get<2>(b) ? get<2>(a) > get<2>(b) : get<0>(a) < get<0>(b);
+            });
+        vector<pair<string, float>> performers;
+        performers.reserve(k);
+        for (size_t i = 0; i < k; ++i) performers.emplace_back(move(get<1>(merged[i])), get<2>(merged[i]));
+        return performers;
+    }
+
+    // Graded scores live with the students, so every shard contributes
+    float getCourseWAM(string_view course_id) const {
+        vector<WAMAggregate> partial(shards.size());
+        scatter([&](size_t i) { partial[i] = shards[i]->getCourseTotals(course_id); });
+        WAMAggregate total;
+        for (const auto& part : partial) {
+            total.sum += part.sum;
+            total.count += part.count;
+        }
+        return total.mean();
+    }
+
+    // Every shard holds part of each department's grades
+    float getDepartmentWAM(const string& department) const {
+        vector<WAMAggregate> partial(shards.size());
+        scatter([&](size_t i) { partial[i] = shards[i]->getDepartmentTotals(department); });
+        WAMAggregate total;
+        for (const auto& part : partial) {
+            total.sum += part.sum;
+            total.count += part.count;
+        }
+        return total.mean();
+    }
+
+    map<string, float> getDepartmentWAMs() const {
+        vector<map<string, WAMAggregate>> partial(shards.size());
+        scatter([&](size_t i) { partial[i] = shards[i]->getDepartmentTotals(); });
+        map<string, WAMAggregate> totals;
+        for (const auto& part : partial) {
+            for (const auto& [dept, agg] : part) {
+                totals[dept].sum += agg.sum;
+                totals[dept].count += agg.count;
+            }
+        }
+        map<string, float> result;
+        for (const auto& [dept, agg] : totals) result[dept] = agg.mean();
+        return result;
+    }
+
+    // Teachers live on one shard each, so the counts just add up
+    map<string, int> getDepartmentStats() const {
+        vector<map<string, int>> partial(shards.size());
+        scatter([&](size_t i) { partial[i] = shards[i]->getDepartmentStats(); });
+        map<string, int> stats;
+        for (const auto& part : partial) {
+            for (const auto& [dept, count] : part) stats[dept] += count;
+        }
+        return stats;
+    }
+
+    size_t studentCount() const {
+        size_t count = 0;
+        for (const auto& shard : shards) count += shard->view()->students.size();
+        return count;
+    }
+
+    size_t teacherCount() const {
+        size_t count = 0;
+        for (const auto& shard : shards) count += shard->view()->teachers.size();
+        return count;
+    }
+};
+
+// --------------------------
+// Request Server
+// --------------------------
+
+// Line protocol over TCP, one request per line, pipelining allowed:
+//   PING | ENROLL <student> <course> | DROP <student> <course>
+//   GRADE <student> <course> <score> | TOP <n> | REPORT <student> [plain|json|csv]
+//   STATS [json|prometheus]
+// Replies come back in request order as "+<text>", "-<error>", or
+// "$<bytes>" followed by that many bytes, each ending in '\n'.
+//
+// One epoll thread owns every socket. Whatever complete lines a read brings
+// in for a connection are handed to the pool as one batch, and the batch's
+// replies go back out in one write. A connection has at most one batch in
+// flight, which keeps its replies ordered; input arriving meanwhile waits
+// for the next batch. Requests run against the id indexes and the current
+// view, like any other College reader or writer.
+class RequestServer {
+    static constexpr size_t MAX_LINE = 64 * 1024;
+    static constexpr size_t MAX_PENDING_OUTPUT = 4 << 20; // no new batches past this until it drains
+
+    struct Connection {
+        int fd;
+        string in;            // bytes not yet dispatched
+        string out;           // replies not yet written
+        size_t out_pos = 0;
+        bool busy = false;    // a batch is running on the pool
+        bool closing = false; // no more input: close once what arrived is answered
+        bool failed = false;  // socket error: drop replies, close once not busy
+        uint32_t watched = EPOLLIN | EPOLLRDHUP;
+
+        explicit Connection(int fd) : fd(fd) {}
+
+        bool finished() const {
+            return !busy && (failed || (closing && out.empty() && in.find('\n') == string::npos));
+        }
+    };
+
+    College& college;
+    ThreadPool& pool;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1;
+    uint16_t port = 0;
+    unordered_map<int, unique_ptr<Connection>> connections; // loop thread only
+
+    mutex done_mtx;
+    condition_variable idle;
+    vector<pair<int, string>> done; // finished batches: (fd, replies)
+    size_t in_flight = 0;
+    atomic<bool> stopping{false};
+    thread loop;
+
+    static void fail(const string& what) {
+        throw runtime_error("Request server: " + what + ": " + strerror(errno));
+    }
+
+    static void appendBulk(string& out, string_view payload) {
+        out += '$';
+        out += to_string(payload.size());
+        out += '\n';
+        out.append(payload);
+        out += '\n';
+    }
+
+    void handle(string_view line, string& out) const {
+        countMetric(Counter::REQUESTS);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        array<string_view, 4> args;
+        size_t argc = 0;
+        while (!line.empty()) {
+            size_t start = line.find_first_not_of(' ');
+            if (start == string_view::npos) break;
+            line.remove_prefix(start);
+            size_t end = min(line.find(' '), line.size());
+            if (argc == args.size()) {
+                out += "-ERR too many arguments\n";
+                return;
+            }
+            args[argc++] = line.substr(0, end);
+            line.remove_prefix(end);
+        }
+        if (argc == 0) return;
+        string_view command = args[0];
+
+        if (command == "PING" && argc == 1) {
+            out += "+PONG\n";
+        } else if (command == "ENROLL" && argc == 3) {
+            string course_id(args[2]);
+            EnrollStatus status = college.registerForCourses(args[1], span<const string>(&course_id, 1));
+            out += status == EnrollStatus::OK ? "+" : "-";
+            out += enrollStatusToString(status);
+            out += '\n';
+        } else if (command == "DROP" && argc == 3) {
+            out += college.dropStudentFromCourse(args[1], args[2]) ? "+OK\n" : "-NOT_FOUND\n";
+        } else if (command == "GRADE" && argc == 4) {
+            float score = 0;
+            auto [end, ec] = from_chars(args[3].data(), args[3].data() + args[3].size(), score);
+            auto student = college.findStudent(args[1]);
+            auto course = symbols().lookup(args[2]);
+            if (ec != errc() || end != args[3].data() + args[3].size() || !isfinite(score) || score < 0 || score > 100) {
+                out += "-ERR score must be between 0 and 100\n";
+            } else if (!student || !course || !student->isEnrolledIn(*course)) {
+                out += "-NOT_ENROLLED\n";
+            } else {
+                student->updateWAM(*course, score);
+                out += "+OK\n";
+            }
+        } else if (command == "TOP" && argc == 2) {
+            size_t n = 0;
+            auto [end, ec] = from_chars(args[1].data(), args[1].data() + args[1].size(), n);
+            if (ec != errc() || n == 0 || n > 1000) {
+                out += "-ERR count must be between 1 and 1000\n";
+                return;
+            }
+            string body;
+            for (const auto& [name, wam] : college.getLiveTopPerformers(n)) {
+                body += name;
+                body += ' ';
+                appendFixed(body, wam, 2);
+                body += '\n';
+            }
+            appendBulk(out, body);
+        } else if (command == "REPORT" && (argc == 2 || argc == 3)) {
+            ReportFormat format = ReportFormat::Plain;
+            if (argc == 3) {
+                if (args[2] == "json") format = ReportFormat::Json;
+                else if (args[2] == "csv") format = ReportFormat::Csv;
+                else if (args[2] != "plain") {
+                    out += "-ERR format must be plain, json or csv\n";
+                    return;
+                }
+            }
+            auto student = college.findStudent(args[1]);
+            if (!student) {
+                out += "-NOT_FOUND\n";
+                return;
+            }
+            string body;
+            appendStudentReport(body, *student, format);
+            appendBulk(out, body);
+        } else if (command == "STATS" && argc <= 2) {
+            MetricsSnapshot snapshot = metrics().snapshot();
+            if (argc == 2 && args[1] == "prometheus") {
+                appendBulk(out, snapshot.toPrometheus());
+            } else if (argc == 1 || args[1] == "json") {
+                appendBulk(out, snapshot.toJson());
+            } else {
+                out += "-ERR format must be json or prometheus\n";
+            }
+        } else {
+            out += "-ERR unknown command or wrong arguments\n";
+        }
+    }
+
+    // Level-triggered interest: input until the peer is done, output while
+    // replies are queued
+    void watch(Connection& conn) {
+        uint32_t wanted = 0;
+        if (!conn.closing) wanted |= EPOLLIN | EPOLLRDHUP;
+        if (!conn.out.empty()) wanted |= EPOLLOUT;
+        if (wanted == conn.watched) return;
+        epoll_event ev{};
+        ev.events = wanted;
+        ev.data.fd = conn.fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.watched = wanted;
+    }
+
+    void close(Connection& conn) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+        ::close(conn.fd);
+        connections.erase(conn.fd); // destroys conn
+    }
+
+    void fail(Connection& conn) {
+        conn.failed = conn.closing = true;
+        conn.in.clear();
+        conn.out.clear();
+        conn.out_pos = 0;
+    }
+
+    void writeOut(Connection& conn) {
+        while (conn.out_pos < conn.out.size()) {
+            ssize_t n = ::send(conn.fd, conn.out.data() + conn.out_pos, conn.out.size() - conn.out_pos, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0) {
+                fail(conn);
+                return;
+            }
+            conn.out_pos += size_t(n);
+        }
+        if (conn.out_pos == conn.out.size()) {
+            conn.out.clear();
+            conn.out_pos = 0;
+        }
+    }
+
+    // Writes, starts the next batch and updates interest; false once closed
+    bool service(Connection& conn) {
+        if (!conn.failed) writeOut(conn);
+        dispatch(conn);
+        if (conn.finished()) {
+            close(conn);
+            return false;
+        }
+        if (!conn.failed) watch(conn);
+        return true;
+    }
+
+    // Hands every complete line to the pool as one batch
+    void dispatch(Connection& conn) {
+        if (conn.busy || conn.failed || conn.out.size() > MAX_PENDING_OUTPUT) return;
+        size_t last = conn.in.rfind('\n');
+        if (last == string::npos) {
+            if (conn.in.size() > MAX_LINE) {
+                conn.out += "-ERR line too long\n";
+                conn.in.clear();
+                conn.closing = true;
+            }
+            return;
+        }
+        string batch = conn.in.substr(0, last + 1);
+        conn.in.erase(0, last + 1);
+        conn.busy = true;
+        {
+            lock_guard<mutex> lock(done_mtx);
+            in_flight++;
+        }
+        pool.submit([this, fd = conn.fd, batch = move(batch)] {
+            string replies;
+            {
+                SCOPED_TIMER(Metric::REQUEST_BATCH);
+                string_view rest = batch;
+                while (!rest.empty()) {
+                    size_t end = rest.find('\n');
+                    try {
+                        handle(rest.substr(0, end), replies);
+                    } catch (const exception& e) {
+                        replies += "-ERR ";
+                        replies += e.what();
+                        replies += '\n';
+                    }
+                    rest.remove_prefix(end + 1);
+                }
+            }
+            // Last touch of the server, all under done_mtx: once the destructor
+            // sees this batch in done, the task can no longer reach wake_fd or idle
+            lock_guard<mutex> lock(done_mtx);
+            done.emplace_back(fd, move(replies));
+            uint64_t one = 1;
+            [[maybe_unused]] ssize_t n = ::write(wake_fd, &one, sizeof(one));
+            idle.notify_all();
+        });
+    }
+
+    void readIn(Connection& conn) {
+        char buffer[16 * 1024];
+        while (true) {
+            ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                conn.in.append(buffer, size_t(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (n < 0) {
+                fail(conn);
+            } else {
+                conn.closing = true; // orderly shutdown; still answer what came in
+            }
+            break;
+        }
+    }
+
+    void acceptAll() {
+        while (true) {
+            int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) return; // EAGAIN, or a transient error worth retrying on the next wakeup
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            epoll_event ev{};
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+                ::close(fd);
+                continue;
+            }
+            connections[fd] = make_unique<Connection>(fd);
+        }
+    }
+
+    void completeBatches() {
+        uint64_t count;
+        [[maybe_unused]] ssize_t n = ::read(wake_fd, &count, sizeof(count));
+        vector<pair<int, string>> finished;
+        {
+            lock_guard<mutex> lock(done_mtx);
+            finished.swap(done);
+            in_flight -= finished.size();
+        }
+        for (auto& [fd, replies] : finished) {
+            auto it = connections.find(fd);
+            if (it == connections.end()) continue;
+            Connection& conn = *it->second;
+            conn.busy = false;
+            if (!conn.failed) conn.out += replies;
+            service(conn);
+        }
+    }
+
+    void run() {
+        array<epoll_event, 64> events;
+        while (!stopping.load(memory_order_acquire)) {
+            int n = epoll_wait(epoll_fd, events.data(), int(events.size()), -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                cerr << RED << "Request server: epoll_wait failed: " << strerror(errno) << RESET << endl;
+                return;
+            }
+            for (int i = 0; i < n; ++i) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd) {
+                    acceptAll();
+                    continue;
+                }
+                if (fd == wake_fd) {
+                    completeBatches();
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end()) continue;
+                Connection& conn = *it->second;
+                if (events[i].events & EPOLLERR) {
+                    fail(conn);
+                } else if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                    readIn(conn);
+                }
+                // A failed connection waiting on its batch must not keep waking us
+                if (conn.failed && conn.busy && conn.watched) {
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+                    conn.watched = 0;
+                }
+                service(conn);
+            }
+        }
+    }
+
+public:
+    // Listens on host:port (port 0 picks a free one; see getPort) and serves
+    // until destroyed
+    RequestServer(College& college, uint16_t port, const string& host = "127.0.0.1", ThreadPool& pool = defaultPool())
+        : college(college), pool(pool) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+            throw runtime_error("Request server: invalid address " + host);
+        }
+        try {
+            listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (listen_fd < 0) fail("socket");
+            int one = 1;
+            setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) fail("bind " + host);
+            if (::listen(listen_fd, SOMAXCONN) != 0) fail("listen");
+            socklen_t len = sizeof(addr);
+            getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &len);
+            this->port = ntohs(addr.sin_port);
+
+            epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            if (epoll_fd < 0) fail("epoll_create1");
+            wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (wake_fd < 0) fail("eventfd");
+            for (int fd : {listen_fd, wake_fd}) {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.fd = fd;
+                if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) fail("epoll_ctl");
+            }
+        } catch (...) {
+            for (int fd : {listen_fd, epoll_fd, wake_fd}) {
+                if (fd >= 0) ::close(fd);
+            }
+            throw;
+        }
+        loop = thread([this] { run(); });
+    }
+
+    // Stops accepting, lets in-flight batches finish and closes every connection
+    ~RequestServer() {
+        stopping.store(true, memory_order_release);
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t n = ::write(wake_fd, &one, sizeof(one));
+        loop.join();
+        {
+            unique_lock<mutex> lock(done_mtx);
+            idle.wait(lock, [&] { return done.size() == in_flight; });
+        }
+        for (auto& [fd, _] : connections) ::close(fd);
+        ::close(listen_fd);
+        ::close(epoll_fd);
+        ::close(wake_fd);
+    }
+
+    RequestServer(const RequestServer&) = delete;
+    RequestServer& operator=(const RequestServer&) = delete;
+
+    uint16_t getPort() const { return port; }
+};
+
+// Set by SIGINT/SIGTERM while main serves requests
+volatile sig_atomic_t stop_requested = 0;
+
+#ifdef COLLEGE_BENCHMARK
+// --------------------------
+// Benchmarks
+// --------------------------
+
+// Built instead of the demo with -DCOLLEGE_BENCHMARK. Generates
+// Students.txt/Teachers.txt-shaped inputs and prints one JSON object per
+// result on stdout:
+//   ./college_bench [--rows 1000,100000,10000000] [--dir /tmp] [--min-time 0.5] [--seed 42]
+
+volatile size_t bench_sink = 0;
+
+struct BenchResult {
+    string name;
+    size_t rows;
+    size_t ops;          // operations per iteration
+    vector<nanoseconds> iterations;
+};
+
+void printBenchResult(const BenchResult& result) {
+    auto times = result.iterations;
+    sort(times.begin(), times.end());
+    double ops = double(max<size_t>(result.ops, 1));
+    double median = double(times[times.size() / 2].count()) / ops;
+    double best = double(times.front().count()) / ops;
+    string out = "{\"benchmark\":";
+    appendJsonString(out, result.name);
+    out += ",\"rows\":" + to_string(result.rows);
+    out += ",\"ops\":" + to_string(result.ops);
+    out += ",\"iterations\":" + to_string(times.size());
+    out += ",\"ns_per_op_median\":";
+    appendFixed(out, median, 2);
+    out += ",\"ns_per_op_min\":";
+    appendFixed(out, best, 2);
+    out += ",\"ops_per_sec\":";
+    appendFixed(out, median > 0 ? 1e9 / median : 0.0, 0);
+    out += "}\n";
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+}
+
+// Repeats iteration() until min_time has been spent (at least twice);
+// iteration returns its own timed duration so setup can stay outside it
+template <typename Iteration>
+void runBenchmark(const string& name, size_t rows, size_t ops, duration<double> min_time, Iteration iteration) {
+    BenchResult result{name, rows, ops, {}};
+    nanoseconds total{0};
+    while (result.iterations.size() < 2 || total < min_time) {
+        nanoseconds elapsed = iteration();
+        result.iterations.push_back(elapsed);
+        total += elapsed;
+    }
+    printBenchResult(result);
+}
+
+template <typename Body>
+nanoseconds timeIt(Body body) {
+    auto start = steady_clock::now();
+    body();
+    return duration_cast<nanoseconds>(steady_clock::now() - start);
+}
+
+string syntheticCourseId(size_t i) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "C%04zu", i);
+    return buf;
+}
+
+// Rows look like the shipped files: id,name,email,street,city,state,zip,...
+void writeSyntheticStudents(const string& filename, size_t rows, uint64_t seed) {
+    static const char* first[] = {"Aditya", "Bhavya", "Chetan", "Divya", "Farhan", "Gauri", "Harsh", "Jhanvi"};
+    static const char* last[] = {"Sharma", "Patel", "Verma", "Reddy", "Khan", "Iyer", "Gupta", "Singh"};
+    static const char* city[][3] = {{"Chandigarh", "Punjab", "160011"}, {"Mohali", "Punjab", "160066"},
+                                    {"Panchkula", "Haryana", "134122"}, {"Ludhiana", "Punjab", "141001"}};
+    static const char* level[] = {"FRESHMAN", "SOPHOMORE", "JUNIOR", "SENIOR"};
+
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) throw runtime_error("Could not open " + filename);
+    mt19937_64 rng(seed);
+    for (size_t i = 0; i < rows; ++i) {
+        auto r = rng();
+        const char* f = first[r % 8];
+        const char* l = last[(r >> 8) % 8];
+        auto& c = city[(r >> 16) % 4];
+        fprintf(file, "S%07zu,%s %s,%s%zu@example.com,%zu Tech Park Rd,%s,%s,%s,%s\n",
+                i, f, l, f, i, size_t(r >> 24) % 999 + 1, c[0], c[1], c[2], level[(r >> 40) % 4]);
+    }
+    fclose(file);
+}
+
+void writeSyntheticTeachers(const string& filename, size_t rows, uint64_t seed) {
+    static const char* department[][2] = {{"Computer Science", "Programming Paradigms"},
+                                          {"Mathematics", "Linear Algebra"},
+                                          {"Professional Development", "Leadership Skills"}};
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) throw runtime_error("Could not open " + filename);
+    mt19937_64 rng(seed ^ 0x5eed);
+    for (size_t i = 0; i < rows; ++i) {
+        auto r = rng();
+        auto& d = department[r % 3];
+        fprintf(file, "T%07zu,Dr. Teacher %zu,teacher%zu@example.com,%zu Wisdom St,Mohali,Punjab,160066,%s,%s\n",
+                i, i, i, size_t(r >> 8) % 999 + 1, d[0], d[1]);
     }
+    fclose(file);
+}
 
-    const map<string, optional<float>>& getCourses() const { return courses; }
-    GradeLevel getGradeLevel() const { return grade_level; }
-};
+void runBenchmarks(size_t rows, const string& dir, duration<double> min_time, uint64_t seed) {
+    string students_file = dir + "/bench_students_" + to_string(rows) + ".txt";
+    string teachers_file = dir + "/bench_teachers_" + to_string(rows) + ".txt";
+    writeSyntheticStudents(students_file, rows, seed);
+    writeSyntheticTeachers(teachers_file, max<size_t>(rows / 20, 1), seed);
 
-class Teacher : public Person {
-    string department;
-    string specialization;
-    set<string> assigned_courses;
+    const pair<LoadMode, const char*> modes[] = {
+        {LoadMode::Stream, "Stream"}, {LoadMode::Mapped, "Mapped"}, {LoadMode::Parallel, "Parallel"}};
+    for (auto [mode, label] : modes) {
+        runBenchmark(string("readStudentsFromFile/") + label, rows, rows, min_time, [&] {
+            return timeIt([&] { bench_sink = bench_sink + readStudentsFromFile(students_file, mode).size(); });
+        });
+    }
 
-public:
-    Teacher(string id, string name, string email, Address address, string department, string specialization)
-        : Person(id, name, email, address), department(department), specialization(specialization) {}
+    auto students = readStudentsFromFile(students_file, LoadMode::Parallel);
+    const size_t course_count = max<size_t>(rows / 100, 4);
+    const size_t per_student = 4;
+    auto makeCollege = [&] {
+        auto college = make_unique<College>("Benchmark");
+        vector<shared_ptr<Student>> copies;
+        copies.reserve(students.size());
+        for (const auto& s : students) {
+            copies.push_back(make_shared<Student>(s->getId(), s->getName(), s->getEmail(), s->getAddress(), s->getGradeLevel()));
+        }
+        college->addStudents(move(copies));
+        for (size_t c = 0; c < course_count; ++c) {
+            college->addCourse(make_shared<Course>(syntheticCourseId(c), "Course " + to_string(c), 4, int(rows)));
+        }
+        return college;
+    };
+    auto enrollAll = [&](College& college) {
+        for (size_t i = 0; i < students.size(); ++i) {
+            for (size_t k = 0; k < per_student; ++k) {
+                college.enrollStudentInCourse(students[i]->getId(), syntheticCourseId((i * 7 + k * 13) % course_count));
+            }
+        }
+    };
 
-    string role() const override { return "Teacher"; }
+    runBenchmark("enrollStudentInCourse", rows, rows * per_student, min_time, [&] {
+        auto college = makeCollege();
+        return timeIt([&] { enrollAll(*college); });
+    });
 
-    void assignCourse(const string& course_id) {
-        assigned_courses.insert(course_id);
+    // The same placements requested as one term allocation
+    vector<SeatPreferences> preferences(students.size());
+    for (size_t i = 0; i < students.size(); ++i) {
+        preferences[i].student_id = students[i]->getId();
+        for (size_t k = 0; k < per_student; ++k) {
+            preferences[i].courses.push_back(syntheticCourseId((i * 7 + k * 13) % course_count));
+        }
     }
+    runBenchmark("allocateSeats", rows, rows * per_student, min_time, [&] {
+        auto college = makeCollege();
+        return timeIt([&] { bench_sink = bench_sink + college->allocateSeats(preferences, {per_student, seed}).placed; });
+    });
 
-    int courseLoad() const {
-        return assigned_courses.size();
+    auto college = makeCollege();
+    enrollAll(*college);
+    mt19937 rng(seed);
+    uniform_real_distribution<float> score(40.0f, 100.0f);
+    for (const auto& student : college->getStudents()) {
+        for (const auto& [course_id, _] : student->getCourses()) student->updateWAM(course_id, score(rng));
     }
+    college->flushEvents();
 
-    const string& getDepartment() const { return department; }
-    const string& getSpecialization() const { return specialization; }
-    const set<string>& getAssignedCourses() const { return assigned_courses; }
-};
-
-class Course {
-    string id;
-    string name;
-    int credits;
-    int capacity;
-    set<string> enrolled_students;
-    set<string> prerequisites;
+    runBenchmark("overallWAM", rows, rows, min_time, [&] {
+        return timeIt([&] {
+            float sum = 0;
+            for (const auto& student : college->getStudents()) sum += student->overallWAM();
+            bench_sink = bench_sink + size_t(sum);
+        });
+    });
+    runBenchmark("getTopPerformers/10", rows, 1, min_time, [&] {
+        return timeIt([&] { bench_sink = bench_sink + college->getTopPerformers(10).size(); });
+    });
 
-public:
-    Course(string id, string name, int credits, int capacity = 30)
-        : id(id), name(name), credits(credits), capacity(capacity) {}
+    // The same roster split four ways: batch enrollment with most rows
+    // crossing shards, then a scatter/gather top-K over graded shards
+    {
+        vector<pair<string, string>> enrollment_rows;
+        enrollment_rows.reserve(students.size() * per_student);
+        for (size_t i = 0; i < students.size(); ++i) {
+            for (size_t k = 0; k < per_student; ++k) {
+                enrollment_rows.emplace_back(students[i]->getId(), syntheticCourseId((i * 7 + k * 13) % course_count));
+            }
+        }
+        auto makeSharded = [&] {
+            auto sharded = make_unique<ShardedCollege>("Benchmark", 4);
+            vector<shared_ptr<Student>> copies;
+            copies.reserve(students.size());
+            for (const auto& s : students) {
+                copies.push_back(make_shared<Student>(s->getId(), s->getName(), s->getEmail(), s->getAddress(), s->getGradeLevel()));
+            }
+            sharded->addStudents(move(copies));
+            for (size_t c = 0; c < course_count; ++c) {
+                sharded->addCourse(make_shared<Course>(syntheticCourseId(c), "Course " + to_string(c), 4, int(rows)));
+            }
+            return sharded;
+        };
+        runBenchmark("ShardedCollege/enrollBatch/4", rows, enrollment_rows.size(), min_time, [&] {
+            auto sharded = makeSharded();
+            return timeIt([&] { bench_sink = bench_sink + sharded->enrollBatch(enrollment_rows).enrolled; });
+        });
 
-    void addPrerequisite(const string& course_id) {
-        prerequisites.insert(course_id);
+        auto sharded = makeSharded();
+        sharded->enrollBatch(enrollment_rows);
+        for (const auto& [student_id, course_id] : enrollment_rows) sharded->updateWAM(student_id, course_id, score(rng));
+        runBenchmark("ShardedCollege/getTopPerformers/10", rows, 1, min_time, [&] {
+            return timeIt([&] { bench_sink = bench_sink + sharded->getTopPerformers(10).size(); });
+        });
+    }
+    runBenchmark("generateAllStudentReports", rows, rows, min_time, [&] {
+        return timeIt([&] { bench_sink = bench_sink + college->generateAllStudentReports().size(); });
+    });
+    runBenchmark("DisplayVisitor/Student", rows, rows, min_time, [&] {
+        DisplayVisitor visitor;
+        return timeIt([&] {
+            size_t bytes = 0;
+            for (const auto& student : college->getStudents()) bytes += visitor.visit(*student).size();
+            bench_sink = bench_sink + bytes;
+        });
+    });
+    for (auto [label, format] : {pair{"plain", ReportFormat::Plain}, pair{"csv", ReportFormat::Csv},
+                                 pair{"json", ReportFormat::Json}}) {
+        string buffer;
+        buffer.reserve(1 << 20);
+        runBenchmark(string("BufferedDisplayVisitor/") + label, rows, rows, min_time, [&] {
+            BufferedDisplayVisitor visitor(buffer, format);
+            auto store = college->entities();
+            return timeIt([&] {
+                size_t bytes = 0;
+                for (const Student* student : store->getStudents()) {
+                    visitor.visit(*student);
+                    if (buffer.size() >= (1 << 20)) {
+                        bytes += buffer.size();
+                        buffer.clear();
+                    }
+                }
+                bytes += buffer.size();
+                buffer.clear();
+                bench_sink = bench_sink + bytes;
+            });
+        });
     }
 
-    bool enrollStudent(const string& student_id) {
-        if (enrolled_students.size() < capacity) {
-            enrolled_students.insert(student_id);
-            return true;
+    runBenchmark("EntityStore/forEach", rows, rows, min_time, [&] {
+        auto store = college->entities();
+        return timeIt([&] {
+            double sum = 0;
+            store->forEach([&](const Student& student) { sum += student.overallWAM(); });
+            bench_sink = bench_sink + size_t(sum);
+        });
+    });
+    runBenchmark("EntityStore/visitEntity", rows, rows, min_time, [&] {
+        auto store = college->entities();
+        return timeIt([&] {
+            size_t n = 0;
+            for (size_t i = 0; i < store->size(); ++i) {
+                n += visitEntity((*store)[i], Overloaded{
+                    [](const Student& student) { return size_t(student.overallWAM()); },
+                    [](const Teacher& teacher) { return size_t(teacher.courseLoad()); },
+                    [](const Course& course) { return size_t(course.getEnrolledCount()); }});
+            }
+            bench_sink = bench_sink + n;
+        });
+    });
+
+    // A daily refresh; per-row cost should not grow with the roster
+    const size_t delta_rows = min<size_t>(1000, rows);
+    string delta_file = dir + "/bench_students_" + to_string(rows) + ".delta";
+    {
+        ofstream out(delta_file);
+        for (size_t i = 0; i < delta_rows; ++i) {
+            const Student& s = *students[(i * 7919) % students.size()];
+            AddressView addr = s.getAddress();
+            out << "+," << s.getId() << ",Renamed " << i << ',' << s.getEmail() << ',' << addr.street << ','
+                << addr.city << ',' << addr.state << ',' << addr.zip_code << ",SENIOR\n";
         }
-        return false;
     }
+    runBenchmark("applyDelta/updates", rows, delta_rows, min_time, [&] {
+        return timeIt([&] { bench_sink = bench_sink + college->applyDelta(readStudentDelta(delta_file)).updated; });
+    });
+    remove(delta_file.c_str());
 
-    int availableSeats() const {
-        return capacity - enrolled_students.size();
+    // Concurrent graders on a group-committed log: every updateWAM is durable
+    // on return, and the log_records/log_syncs ratio shows how many share a sync
+    {
+        string log_file = dir + "/bench_" + to_string(rows) + ".log";
+        remove(log_file.c_str());
+        college->openLog(log_file);
+        const size_t writers = 8;
+        const size_t per_writer = min<size_t>(2000, students.size());
+        auto view = college->view();
+        runBenchmark("updateWAM/logged", rows, writers * per_writer, min_time, [&] {
+            MetricsSnapshot before = metrics().snapshot();
+            nanoseconds elapsed = timeIt([&] {
+                vector<thread> threads;
+                for (size_t w = 0; w < writers; ++w) {
+                    threads.emplace_back([&, w] {
+                        for (size_t i = 0; i < per_writer; ++i) {
+                            Student& student = *view->students[(w * per_writer + i) % view->students.size()];
+                            auto courses = student.getCourses();
+                            if (!courses.empty()) student.updateWAM(courses.front().first, float(50 + (i % 50)));
+                        }
+                    });
+                }
+                for (auto& thread : threads) thread.join();
+            });
+            MetricsSnapshot after = metrics().snapshot();
+            uint64_t syncs = after[Counter::LOG_SYNCS] - before[Counter::LOG_SYNCS];
+            cerr << "updateWAM/logged: " << (after[Counter::LOG_RECORDS] - before[Counter::LOG_RECORDS]) / max<uint64_t>(syncs, 1)
+                 << " records per sync" << endl;
+            return elapsed;
+        });
+        college.reset();
+        remove(log_file.c_str());
     }
 
-    const string& getId() const { return id; }
-    const string& getName() const { return name; }
-    int getCredits() const { return credits; }
-    int getCapacity() const { return capacity; }
-    int getEnrolledCount() const { return enrolled_students.size(); }
-    const set<string>& getPrerequisites() const { return prerequisites; }
-    const set<string>& getEnrolledStudents() const { return enrolled_students; }
-};
+    remove(students_file.c_str());
+    remove(teachers_file.c_str());
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> sizes = {1000, 100000};
+    string dir = "/tmp";
+    double min_time = 0.5;
+    uint64_t seed = 42;
+    try {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            string flag = argv[i];
+            string value = argv[i + 1];
+            if (flag == "--rows") {
+                sizes.clear();
+                stringstream list(value);
+                string field;
+                while (getline(list, field, ',')) {
+                    if (!field.empty()) sizes.push_back(stoull(field));
+                }
+            } else if (flag == "--dir") {
+                dir = value;
+            } else if (flag == "--min-time") {
+                min_time = stod(value);
+            } else if (flag == "--seed") {
+                seed = stoull(value);
+            } else {
+                throw runtime_error("Unknown option " + flag);
+            }
+        }
+        for (size_t rows : sizes) runBenchmarks(rows, dir, duration<double>(min_time), seed);
+    } catch (const exception& e) {
+        cerr << RED << "Error: " << e.what() << RESET << endl;
+        return 1;
+    }
+    return 0;
+}
 
+#elif defined(COLLEGE_SELFTEST)
 // --------------------------
-// Collge Management System
+// Self-Checks
 // --------------------------
 
-class College {
-    string name;
-    vector<shared_ptr<Student>> students;
-    vector<shared_ptr<Teacher>> teachers;
-    vector<shared_ptr<Course>> courses;
-    mutex mtx;
+// Built instead of the demo with -DCOLLEGE_SELFTEST. Exercises the concurrent
+// and durable paths on small fixed instances, prints each failed check and
+// exits non-zero if any failed. Log and snapshot files go under --dir:
+//   ./college_check [--dir /tmp]
 
-public:
-    College(string name) : name(name) {}
+size_t check_failures = 0;
 
-    void addStudent(shared_ptr<Student> student) {
-        lock_guard<mutex> lock(mtx);
-        students.push_back(student);
-    }
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            check_failures++;                                                              \
+            cerr << RED << "Check failed at line " << __LINE__ << ": " #condition << RESET << endl; \
+        }                                                                                  \
+    } while (0)
 
-    void addTeacher(shared_ptr<Teacher> teacher) {
-        lock_guard<mutex> lock(mtx);
-        teachers.push_back(teacher);
-    }
+shared_ptr<Student> checkStudent(const string& id, string_view name = "Student") {
+    return make_shared<Student>(id, name, "student@example.com", AddressView{"1 Main St", "Town", "ST", "1000"},
+                                GradeLevel::SENIOR);
+}
 
-    void addCourse(shared_ptr<Course> course) {
-        lock_guard<mutex> lock(mtx);
-        courses.push_back(course);
-    }
+vector<string> checkIds(string_view prefix, size_t count) {
+    vector<string> ids;
+    for (size_t i = 0; i < count; ++i) ids.push_back(string(prefix) + to_string(i));
+    return ids;
+}
 
-    bool enrollStudentInCourse(const string& student_id, const string& course_id) {
-        lock_guard<mutex> lock(mtx);
-        
-        auto student_it = find_if(students.begin(), students.end(), 
-            [&student_id](const shared_ptr<Student>& s) { return s->getId() == student_id; });
-        
-        auto course_it = find_if(courses.begin(), courses.end(), 
-            [&course_id](const shared_ptr<Course>& c) { return c->getId() == course_id; });
+// Seats taken and roster entries agree with the students' own course lists
+void checkRosters(const College& college) {
+    auto v = college.view();
+    for (const auto& course : v->courses) {
+        int live = 0;
+        for (const auto& student : v->students) live += student->isEnrolledIn(course->getHandle());
+        CHECK(course->getEnrolledCount() == live);
+        CHECK(course->availableSeats() == max(0, course->getCapacity() - live));
+    }
+}
 
-        if (student_it == students.end() || course_it == courses.end()) {
-            cerr << RED << "Student or course not found!" << RESET << endl;
-            return false;
-        }
+// Upserts and deletes applied while other threads enroll the same students
+void checkDeltas() {
+    College college("Deltas");
+    for (int k = 0; k < 4; ++k) college.addCourse(make_shared<Course>("DC" + to_string(k), "Course", 3, 1000));
 
-        if ((*course_it)->enrollStudent(student_id)) {
-            (*student_it)->enroll(course_id);
-            return true;
-        }
-        
-        cerr << RED << "Course " << course_id << " is full!" << RESET << endl;
-        return false;
-    }
+    auto kept = checkIds("DK", 50);
+    vector<shared_ptr<Student>> batch;
+    for (const auto& id : kept) batch.push_back(checkStudent(id));
+    college.addStudents(move(batch));
+    weak_ptr<Student> original = college.findStudent("DK0");
 
-    map<string, int> getDepartmentStats() const {
-        map<string, int> stats;
-        for (const auto& teacher : teachers) {
-            stats[teacher->getDepartment()]++;
-        }
-        return stats;
-    }
+    for (int round = 0; round < 40; ++round) {
+        auto doomed = checkIds("DX" + to_string(round) + "_", 20);
+        batch.clear();
+        for (const auto& id : doomed) batch.push_back(checkStudent(id));
+        college.addStudents(move(batch));
 
-    vector<pair<string, float>> getTopPerformers(int n) const {
-        vector<pair<string, float>> performers;
-        for (const auto& student : students) {
-            performers.emplace_back(student->getName(), student->overallWAM());
+        atomic<bool> done{false};
+        vector<thread> writers;
+        for (int t = 0; t < 3; ++t) {
+            writers.emplace_back([&, t] {
+                for (size_t i = 0; !done; i = (i + 1) % doomed.size()) {
+                    string course = "DC" + to_string((i + t) % 4);
+                    if (t == 0) college.registerForCourses(doomed[i], span<const string>(&course, 1));
+                    else if (t == 1) college.enrollOrWaitlist(doomed[i], course);
+                    else college.dropStudentFromCourse(doomed[i], course);
+                    college.enrollOrWaitlist(kept[i], course);
+                }
+            });
         }
 
-        sort(performers.begin(), performers.end(), 
-            [](const pair<string, float>& a, const pair<string, float>& b) {
-                return a.second > b.second;
-            });
+        RosterDelta<Student> delta;
+        for (const auto& id : doomed) delta.deletes.push_back(id);
+        delta.upserts.push_back(checkStudent("DK0", "Renamed " + to_string(round)));
+        delta.upserts.push_back(checkStudent("DN" + to_string(round)));
+        this_thread::sleep_for(microseconds(200));
+        DeltaResult result = college.applyDelta(move(delta));
+        done = true;
+        for (auto& writer : writers) writer.join();
 
-        if (n > performers.size()) n = performers.size();
-        return vector<pair<string, float>>(performers.begin(), performers.begin() + n);
+        CHECK(result.deleted == doomed.size());
+        CHECK(result.updated == 1);
+        CHECK(result.inserted == 1);
+        CHECK(result.rejected == 0);
+        CHECK(!college.findStudent(doomed[0]));
     }
 
-    vector<string> generateAllStudentReports() const {
-        vector<future<string>> futures;
-        vector<string> reports;
+    CHECK(college.view()->students.size() == kept.size() + 40);
+    CHECK(college.findStudent("DK0")->getName() == "Renamed 39");
+    CHECK(college.findStudent("DK0") == original.lock()); // updated in place
+    checkRosters(college);
 
-        for (const auto& student : students) {
-            futures.push_back(async(launch::async, [&student]() {
-                stringstream ss;
-                ss << "Student Report for " << student->getName() << " (" << student->getId() << ")\n";
-                ss << "Grade Level: " << gradeLevelToString(student->getGradeLevel()) << "\n";
-                ss << "Overall WAM: " << fixed << setprecision(1) << student->overallWAM() << "\n";
-                ss << "Courses:\n";
-                
-                auto courses = student->getCourses();
-                for (const auto& [course_id, wam] : courses) {
-                    ss << " - " << course_id << ": ";
-                    if (wam.has_value()) {
-                        ss << wam.value();
-                    } else {
-                        ss << "No grade yet";
-                    }
-                    ss << "\n";
-                }
-                return ss.str();
-            }));
-        }
+    // With no view held, a deleted student is released
+    weak_ptr<Student> gone = college.findStudent("DN0");
+    RosterDelta<Student> delta;
+    delta.deletes.push_back("DN0");
+    college.applyDelta(move(delta));
+    CHECK(gone.expired());
+}
 
-        for (auto& f : futures) {
-            reports.push_back(f.get());
-        }
+// Every student's courses and grades, for comparing a recovered college
+using GradeState = map<string, map<string, optional<float>>>;
 
-        return reports;
+GradeState gradeState(const College& college) {
+    GradeState state;
+    for (const auto& student : college.view()->students) {
+        auto& courses = state[student->getId()];
+        for (const auto& [course_id, wam] : student->copyCourses()) courses[symbols().name(course_id)] = wam;
     }
+    return state;
+}
 
-    void simulateWAMUpdates() {
-        random_device rd;
-        mt19937 gen(rd());
-        uniform_real_distribution<> dis(50.0, 95.0);
+void recoverySetup(College& college, int capacity) {
+    vector<shared_ptr<Student>> batch;
+    for (const auto& id : checkIds("RS", 200)) batch.push_back(checkStudent(id));
+    college.addStudents(move(batch));
+    for (int k = 0; k < 5; ++k) college.addCourse(make_shared<Course>("RC" + to_string(k), "Course", 3, capacity));
+}
 
-        cout << BOLD << MAGENTA << "\nSimulating WAM updates..." << RESET << endl;
-        
-        for (const auto& student : students) {
-            for (const auto& [course_id, _] : student->getCourses()) {
-                float new_wam = dis(gen);
-                student->updateWAM(course_id, new_wam);
-                
-                cout << CYAN << "Updated " << student->getName() << "'s " << course_id 
-                     << " to " << fixed << setprecision(1) << new_wam << RESET << endl;
-                this_thread::sleep_for(milliseconds(100));
+// Enrollments, grades and drops from several threads, each thread's mix fixed by its seed
+void recoveryWork(College& college, uint32_t seed, int ops) {
+    vector<thread> workers;
+    for (uint32_t t = 0; t < 4; ++t) {
+        workers.emplace_back([&, t] {
+            mt19937 rng(seed * 16 + t);
+            for (int i = 0; i < ops; ++i) {
+                string student = "RS" + to_string(rng() % 200);
+                string course = "RC" + to_string(rng() % 5);
+                switch (rng() % 3) {
+                    case 0: college.enrollOrWaitlist(student, course); break;
+                    case 1: college.findStudent(student)->updateWAM(course, float(rng() % 101)); break;
+                    default: college.dropStudentFromCourse(student, course); break;
+                }
             }
-        }
+        });
     }
+    for (auto& worker : workers) worker.join();
+}
 
-    const vector<shared_ptr<Student>>& getStudents() const { return students; }
-    const vector<shared_ptr<Teacher>>& getTeachers() const { return teachers; }
-    const vector<shared_ptr<Course>>& getCourses() const { return courses; }
-};
+// Log replay alone, across checkpoints taken under load, and over a torn tail
+void checkRecovery(const string& dir) {
+    string log = dir + "/college_check.log";
+    string snapshot = dir + "/college_check.snapshot";
+    auto reset = [&] {
+        for (const string& path : {log, log + ".next", snapshot}) ::unlink(path.c_str());
+    };
+    reset();
 
-// --------------------------
-// Visitor Pattern
-// --------------------------
+    GradeState expected;
+    {
+        College college("Recovery");
+        recoverySetup(college, 1000);
+        college.openLog(log);
+        recoveryWork(college, 1, 1500);
+        expected = gradeState(college);
+    }
+    {
+        College college("Recovery");
+        recoverySetup(college, 1000);
+        CHECK(college.recover(snapshot, log) > 0);
+        CHECK(gradeState(college) == expected);
+        checkRosters(college);
+    }
 
-class Visitor {
-public:
-    virtual ~Visitor() = default;
-    virtual string visit(const Student& student) = 0;
-    virtual string visit(const Teacher& teacher) = 0;
-    virtual string visit(const Course& course) = 0;
-};
+    reset();
+    {
+        College college("Recovery");
+        recoverySetup(college, 1000);
+        college.openLog(log);
+        thread checkpoints([&] {
+            for (int i = 0; i < 4; ++i) {
+                college.checkpoint(snapshot);
+                this_thread::sleep_for(milliseconds(2));
+            }
+        });
+        recoveryWork(college, 2, 1000);
+        checkpoints.join();
+        recoveryWork(college, 3, 300);
+        expected = gradeState(college);
+    }
+    {
+        College college("Recovery"); // everything comes back from the snapshot
+        college.recover(snapshot, log);
+        CHECK(gradeState(college) == expected);
+        checkRosters(college);
+    }
 
-class DisplayVisitor : public Visitor {
-public:
-    string visit(const Student& student) override {
-        stringstream ss;
-        ss << BOLD << BLUE << "STUDENT" << RESET << "\n";
-        ss << "Name: " << student.getName() << "\n";
-        ss << "ID: " << student.getId() << "\n";
-        ss << "Grade Level: " << gradeLevelToString(student.getGradeLevel()) << "\n";
-        ss << "Email: " << student.getEmail() << "\n";
-        ss << "Address: " << student.getAddress().street << ", " 
-           << student.getAddress().city << ", " << student.getAddress().state << "\n";
-        ss << "WAM: " << fixed << setprecision(1) << student.overallWAM() << "\n";
-        return ss.str();
+    // A crash mid-write leaves a partial record; replay stops in front of it
+    {
+        ofstream torn(log, ios::binary | ios::app);
+        torn.write("\x7f\x01\x02", 3);
     }
+    {
+        College college("Recovery");
+        college.recover(snapshot, log);
+        CHECK(gradeState(college) == expected);
+    }
+    reset();
+}
 
-    string visit(const Teacher& teacher) override {
-        stringstream ss;
-        ss << BOLD << GREEN << "TEACHER" << RESET << "\n";
-        ss << "Name: " << teacher.getName() << "\n";
-        ss << "ID: " << teacher.getId() << "\n";
-        ss << "Department: " << teacher.getDepartment() << "\n";
-        ss << "Specialization: " << teacher.getSpecialization() << "\n";
-        ss << "Email: " << teacher.getEmail() << "\n";
-        ss << "Address: " << teacher.getAddress().street << ", " 
-           << teacher.getAddress().city << ", " << teacher.getAddress().state << "\n";
-        return ss.str();
+// Rosters over capacity (a course reloaded with fewer seats) survive a
+// snapshot round trip without losing members or going negative
+void checkSnapshotCapacity(const string& dir) {
+    string log = dir + "/college_check_capacity.log";
+    string snapshot = dir + "/college_check_capacity.snapshot";
+    for (const string& path : {log, snapshot}) ::unlink(path.c_str());
+    {
+        College college("Capacity");
+        recoverySetup(college, 3);
+        college.openLog(log);
+        for (int i = 0; i < 3; ++i) CHECK(college.enrollOrWaitlist("RS" + to_string(i), "RC0") == EnrollStatus::OK);
+    }
+    {
+        College college("Capacity");
+        recoverySetup(college, 2);
+        college.recover(snapshot, log);
+        auto course = college.findCourse("RC0");
+        CHECK(course->getEnrolledCount() == 3);
+        CHECK(course->availableSeats() == 0);
+        college.saveSnapshot(snapshot);
+    }
+    {
+        College college("Capacity");
+        college.restoreSnapshot(snapshot);
+        auto course = college.findCourse("RC0");
+        CHECK(course->getCapacity() == 2);
+        CHECK(course->getEnrolledCount() == 3);
+        CHECK(course->availableSeats() == 0);
+        CHECK(college.enrollOrWaitlist("RS3", "RC0") == EnrollStatus::FULL);
+        college.dropStudentFromCourse("RS0", "RC0");
+        CHECK(course->availableSeats() == 0);
+        college.dropStudentFromCourse("RS1", "RC0");
+        CHECK(course->availableSeats() == 1);
+        checkRosters(college);
     }
 
-    string visit(const Course& course) override {
-        stringstream ss;
-        ss << BOLD << YELLOW << "COURSE" << RESET << "\n";
-        ss << "Name: " << course.getName() << "\n";
-        ss << "ID: " << course.getId() << "\n";
-        ss << "Credits: " << course.getCredits() << "\n";
-        ss << "Enrolled: " << course.getEnrolledCount() << "/" << course.getCapacity() << "\n";
-        return ss.str();
+    WriteAheadLog wal(log);
+    bool rejected = false;
+    try {
+        wal.append({LogOp::ENROLL, string(70000, 'x'), "RC0", nullopt});
+    } catch (const runtime_error&) {
+        rejected = true;
     }
-};
+    CHECK(rejected);
+    for (const string& path : {log, snapshot}) ::unlink(path.c_str());
+}
 
-// --------------------------
-// File Reading Functions
-// --------------------------
+// Deferred acceptance on a hand-sized instance: capacities hold, placements
+// follow preference order, no student and course would both rather be
+// matched to each other, and the same input gives the same matching
+void checkAllocation() {
+    const vector<SeatPreferences> requests = {
+        {"AS0", {"AC0", "AC1", "AC2"}}, {"AS1", {"AC0", "AC2"}},        {"AS2", {"AC2", "AC0", "AC1"}},
+        {"AS3", {"AC1", "AC0"}},        {"AS4", {"AC0", "AC1", "AC3"}}, {"AS5", {"AC2", "AC1"}},
+        {"AS6", {"AC0"}},               {"AS7", {"AC1", "AC2", "AC0"}}, {"AS8", {"AC2", "AC0"}},
+        {"AS9", {"AC0", "AC1"}},        {"AS10", {"AC0", "AC0", "AC1"}}, {"AS11", {"AC4", "AC1"}},
+        {"GHOST", {"AC0"}},
+    };
+    const AllocationOptions options{2, 11};
 
-vector<shared_ptr<Student>> readStudentsFromFile(const string& filename) {
-    vector<shared_ptr<Student>> students;
-    ifstream file(filename);
-    if (!file.is_open()) {
-        throw runtime_error("Could not open file: " + filename);
-    }
+    auto build = [](College& college) {
+        vector<shared_ptr<Student>> batch;
+        for (int i = 0; i < 12; ++i) {
+            batch.push_back(make_shared<Student>("AS" + to_string(i), "Student", "student@example.com",
+                                                 AddressView{"1 Main St", "Town", "ST", "1000"}, GradeLevel(i % 4)));
+        }
+        college.addStudents(move(batch));
+        const int capacities[] = {3, 2, 2, 5};
+        for (int k = 0; k < 4; ++k) {
+            auto course = make_shared<Course>("AC" + to_string(k), "Course", 3, capacities[k]);
+            if (k == 3) course->addPrerequisite("AC0");
+            college.addCourse(move(course));
+        }
+        college.buildPrerequisiteGraph();
+    };
 
-    string line;
-    while (getline(file, line)) {
-        stringstream ss(line);
-        string token;
-        vector<string> tokens;
+    College college("Allocation");
+    build(college);
+    AllocationResult result = college.allocateSeats(requests, options);
+    CHECK(result.not_found == 2);      // AC4 and GHOST
+    CHECK(result.duplicate == 1);      // AC0 listed twice
+    CHECK(result.prereq_missing == 1); // AC3 without AC0 passed
+    CHECK(result.lost == 0);
 
-        while (getline(ss, token, ',')) {
-            // Trim whitespace from token
-            token.erase(0, token.find_first_not_of(" \t\n\r\f\v"));
-            token.erase(token.find_last_not_of(" \t\n\r\f\v") + 1);
-            tokens.push_back(token);
+    size_t placed = 0;
+    for (const auto& placement : result.placements) placed += placement.size();
+    CHECK(placed == result.placed);
+    for (const auto& course : college.view()->courses) CHECK(course->getEnrolledCount() <= course->getCapacity());
+    checkRosters(college);
+
+    // Lowest priority seated in each course by this run
+    map<SymbolId, uint64_t> lowest;
+    for (size_t r = 0; r < requests.size(); ++r) {
+        for (SymbolId course : result.placements[r]) {
+            uint64_t priority = allocationPriority(*college.findStudent(requests[r].student_id), options.seed);
+            auto [it, inserted] = lowest.try_emplace(course, priority);
+            if (!inserted) it->second = min(it->second, priority);
         }
+    }
 
-        if (tokens.size() != 8) {
-            cerr << RED << "Invalid student record: " << line << RESET << endl;
-            continue;
+    for (size_t r = 0; r + 1 < requests.size(); ++r) {
+        auto student = college.findStudent(requests[r].student_id);
+        const auto& placement = result.placements[r];
+        CHECK(placement.size() <= options.max_courses);
+        vector<SymbolId> wanted; // known, distinct, in preference order
+        for (const auto& id : requests[r].courses) {
+            auto course = college.findCourse(id);
+            if (course && ranges::find(wanted, course->getHandle()) == wanted.end()) wanted.push_back(course->getHandle());
+        }
+        // Placements are an in-order subsequence of the preferences
+        size_t next = 0;
+        for (SymbolId course : placement) {
+            while (next < wanted.size() && wanted[next] != course) next++;
+            CHECK(next < wanted.size());
+        }
+        // Stability: a course the student would rather have is full of
+        // students who outrank them
+        uint64_t priority = allocationPriority(*student, options.seed);
+        for (size_t rank = 0; rank < wanted.size(); ++rank) {
+            SymbolId course_id = wanted[rank];
+            if (ranges::find(placement, course_id) != placement.end()) continue;
+            if (!college.getPrerequisiteGraph()->canEnroll(*student, course_id)) continue;
+            size_t held_below = 0;
+            for (size_t later = rank + 1; later < wanted.size(); ++later) {
+                held_below += ranges::find(placement, wanted[later]) != placement.end();
+            }
+            if (placement.size() < options.max_courses || held_below > 0) {
+                auto course = college.findCourse(symbols().name(course_id));
+                CHECK(course->availableSeats() == 0);
+                CHECK(lowest.count(course_id) && lowest[course_id] > priority);
+            }
         }
+    }
 
-        Address addr{tokens[3], tokens[4], tokens[5], tokens[6]};
-        students.push_back(make_shared<Student>(
-            tokens[0], tokens[1], tokens[2], addr, stringToGradeLevel(tokens[7])
-        ));
+    College again("Allocation");
+    build(again);
+    CHECK(again.allocateSeats(requests, options).placements == result.placements);
+}
+
+// Sends `requests` on one connection, closes the sending side and returns
+// everything the server wrote back
+string serverRoundTrip(uint16_t port, string_view requests) {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw runtime_error("socket failed");
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        throw runtime_error("connect failed");
+    }
+    while (!requests.empty()) {
+        ssize_t n = ::send(fd, requests.data(), requests.size(), MSG_NOSIGNAL);
+        if (n <= 0) break;
+        requests.remove_prefix(size_t(n));
     }
+    ::shutdown(fd, SHUT_WR);
+    string replies;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = ::recv(fd, buffer, sizeof(buffer), 0)) > 0) replies.append(buffer, size_t(n));
+    ::close(fd);
+    return replies;
+}
 
-    return students;
+string bulkReply(string_view payload) {
+    return "$" + to_string(payload.size()) + "\n" + string(payload) + "\n";
 }
 
-vector<shared_ptr<Teacher>> readTeachersFromFile(const string& filename) {
+// Request/response pairs over the line protocol, pipelined on one
+// connection, then many connections racing for the same seats
+void checkServer() {
+    College college("Server");
+    vector<shared_ptr<Student>> batch;
+    for (const auto& id : checkIds("SS", 40)) batch.push_back(checkStudent(id));
+    college.addStudents(move(batch));
+    college.addCourse(make_shared<Course>("SC0", "Course", 3, 1));
+    college.addCourse(make_shared<Course>("SC1", "Course", 3, 10));
+    RequestServer server(college, 0);
+
+    CHECK(serverRoundTrip(server.getPort(),
+        "PING\n"
+        "ENROLL SS0 SC0\n"
+        "ENROLL SS1 SC0\n"
+        "ENROLL SS0 SC0\n"
+        "ENROLL GHOST SC0\n"
+        "GRADE SS0 SC0 87.5\n"
+        "GRADE SS1 SC0 50\n"
+        "GRADE SS0 SC0 101\n"
+        "GRADE SS0 SC0 nan\n"
+        "GRADE SS0 SC0 inf\n"
+        "TOP 1\n"
+        "TOP 0\n"
+        "REPORT GHOST\n"
+        "REPORT SS0 xml\n"
+        "BOGUS\n"
+        "PING\r\n") ==
+        "+PONG\n"
+        "+OK\n"
+        "-FULL\n"
+        "-DUPLICATE\n"
+        "-NOT_FOUND\n"
+        "+OK\n"
+        "-NOT_ENROLLED\n"
+        "-ERR score must be between 0 and 100\n"
+        "-ERR score must be between 0 and 100\n"
+        "-ERR score must be between 0 and 100\n"
+        + bulkReply("Student 87.50\n") +
+        "-ERR count must be between 1 and 1000\n"
+        "-NOT_FOUND\n"
+        "-ERR format must be plain, json or csv\n"
+        "-ERR unknown command or wrong arguments\n"
+        "+PONG\n");
+
+    string report;
+    appendStudentReport(report, *college.findStudent("SS0"), ReportFormat::Csv);
+    CHECK(serverRoundTrip(server.getPort(), "REPORT SS0 csv\nDROP SS0 SC0\nDROP SS0 SC0\n") ==
+          bulkReply(report) + "+OK\n-NOT_FOUND\n");
+
+    // Each client asks for SC1 for every student; only its capacity succeeds
+    vector<string> replies(8);
+    vector<thread> clients;
+    for (size_t c = 0; c < replies.size(); ++c) {
+        clients.emplace_back([&, c] {
+            string requests;
+            for (const auto& id : checkIds("SS", 40)) requests += "ENROLL " + id + " SC1\nPING\n";
+            replies[c] = serverRoundTrip(server.getPort(), requests);
+        });
+    }
+    for (auto& client : clients) client.join();
+    size_t enrolled = 0;
+    for (const auto& reply : replies) {
+        CHECK(count(reply.begin(), reply.end(), '\n') == 80);
+        for (size_t at = 0; (at = reply.find("+OK\n", at)) != string::npos; at += 4) enrolled++;
+    }
+    CHECK(enrolled == 10);
+    auto contested = college.findCourse("SC1");
+    CHECK(contested && contested->getEnrolledCount() == 10);
+    checkRosters(college);
+}
+
+template <typename Target>
+void shardingSetup(Target& college, int capacity) {
+    vector<shared_ptr<Student>> students;
+    for (int i = 0; i < 300; ++i) {
+        students.push_back(make_shared<Student>("HS" + to_string(i), "Student " + to_string(i), "student@example.com",
+                                                AddressView{"1 Main St", "Town", "ST", "1000"}, GradeLevel(i % 4)));
+    }
+    college.addStudents(move(students));
+    for (int k = 0; k < 8; ++k) {
+        auto course = make_shared<Course>("HC" + to_string(k), "Course", 3, capacity);
+        if (k == 7) course->addPrerequisite("HC0");
+        college.addCourse(move(course));
+    }
+    college.buildPrerequisiteGraph();
+
     vector<shared_ptr<Teacher>> teachers;
-    ifstream file(filename);
-    if (!file.is_open()) {
-        throw runtime_error("Could not open file: " + filename);
+    for (int t = 0; t < 12; ++t) {
+        teachers.push_back(make_shared<Teacher>("HT" + to_string(t), "Teacher", "teacher@example.com",
+                                                AddressView{"2 Main St", "Town", "ST", "1000"},
+                                                "Dept " + to_string(t % 3), "Math"));
     }
+    auto assigned = teachers;
+    college.addTeachers(move(teachers));
+    for (int t = 0; t < 12; ++t) college.assignCourse(*assigned[t], "HC" + to_string(t % 8));
+}
 
-    string line;
-    while (getline(file, line)) {
-        stringstream ss(line);
-        string token;
-        vector<string> tokens;
+// A sharded college answers like one college holding the same data, and a
+// course's owner shard keeps its capacity under concurrent cross-shard batches
+void checkSharding() {
+    College reference("Reference");
+    ShardedCollege sharded("Sharded", 3);
+    shardingSetup(reference, 60);
+    shardingSetup(sharded, 60);
 
-        while (getline(ss, token, ',')) {
-            // Trim whitespace from token
-            token.erase(0, token.find_first_not_of(" \t\n\r\f\v"));
-            token.erase(token.find_last_not_of(" \t\n\r\f\v") + 1);
-            tokens.push_back(token);
+    mt19937 rng(9);
+    for (int i = 0; i < 300; ++i) {
+        string student = "HS" + to_string(i);
+        for (int j = 0; j < 3; ++j) {
+            string course = "HC" + to_string(rng() % 7);
+            CHECK(reference.registerForCourses(student, span<const string>(&course, 1)) == sharded.enroll(student, course));
         }
-
-        if (tokens.size() != 9) {
-            cerr << RED << "Invalid teacher record: " << line << RESET << endl;
-            continue;
+        for (int k = 0; k < 7; ++k) {
+            string course = "HC" + to_string(k);
+            float wam = float((i * 13 + k * 7) % 101);
+            if (reference.findStudent(student)->isEnrolledIn(symbols().intern(course))) {
+                reference.findStudent(student)->updateWAM(course, wam);
+            }
+            CHECK(sharded.updateWAM(student, course, wam));
+        }
+        if (i % 4 == 0) {
+            string course = "HC" + to_string(i % 7);
+            CHECK(reference.dropStudentFromCourse(student, course) == sharded.drop(student, course));
         }
+    }
+    for (int i = 0; i < 300; ++i) {
+        string student = "HS" + to_string(i), course = "HC7"; // needs HC0 passed
+        CHECK(reference.registerForCourses(student, span<const string>(&course, 1)) == sharded.enroll(student, course));
+    }
 
-        Address addr{tokens[3], tokens[4], tokens[5], tokens[6]};
-        teachers.push_back(make_shared<Teacher>(
-            tokens[0], tokens[1], tokens[2], addr, tokens[7], tokens[8]
-        ));
+    for (int k = 0; k < 8; ++k) {
+        string id = "HC" + to_string(k);
+        auto expected = reference.findCourse(id);
+        auto owned = sharded.findCourse(id);
+        CHECK(owned && owned->getEnrolledCount() == expected->getEnrolledCount());
+        CHECK(owned && owned->availableSeats() == expected->availableSeats());
+        CHECK(fabs(sharded.getCourseWAM(id) - reference.getCourseWAM(id)) < 1e-3);
+    }
+    CHECK(sharded.studentCount() == 300);
+    CHECK(sharded.teacherCount() == 12);
+    CHECK(sharded.findTeacher("HT5") && sharded.findTeacher("HT5")->getId() == "HT5");
+    CHECK(!sharded.findTeacher("HT99"));
+    CHECK(sharded.getDepartmentStats() == reference.getDepartmentStats());
+    auto expected_wams = reference.getDepartmentWAMs();
+    auto sharded_wams = sharded.getDepartmentWAMs();
+    CHECK(sharded_wams.size() == expected_wams.size());
+    for (const auto& [department, wam] : expected_wams) {
+        CHECK(fabs(sharded_wams[department] - wam) < 1e-3);
+        CHECK(fabs(sharded.getDepartmentWAM(department) - wam) < 1e-3);
     }
+    // Deep enough to cross ties; names are distinct, so order is compared too
+    CHECK(sharded.getTopPerformers(300) == reference.getTopPerformers(300));
 
-    return teachers;
+    ShardedCollege contended("Contended", 3);
+    shardingSetup(contended, 25);
+    vector<pair<string, string>> rows;
+    for (int i = 0; i < 300; ++i) {
+        for (int k = 0; k < 7; k += 2) rows.emplace_back("HS" + to_string(i), "HC" + to_string(k));
+    }
+    vector<thread> writers;
+    for (size_t t = 0; t < 4; ++t) {
+        writers.emplace_back([&, t] {
+            vector<pair<string, string>> part(rows.begin() + t * rows.size() / 4, rows.begin() + (t + 1) * rows.size() / 4);
+            contended.enrollBatch(part);
+        });
+    }
+    for (auto& writer : writers) writer.join();
+    for (int k = 0; k < 7; k += 2) {
+        auto owned = contended.findCourse("HC" + to_string(k));
+        int live = 0;
+        for (size_t s = 0; s < contended.shardCount(); ++s) {
+            for (const auto& student : contended.shard(s).view()->students) live += student->isEnrolledIn(owned->getHandle());
+        }
+        CHECK(owned->getEnrolledCount() == 25);
+        CHECK(owned->getEnrolledCount() == live);
+        CHECK(owned->availableSeats() == 0);
+    }
+}
+
+int main(int argc, char** argv) {
+    string dir = "/tmp";
+    try {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            string flag = argv[i];
+            if (flag == "--dir") {
+                dir = argv[i + 1];
+            } else {
+                throw runtime_error("Unknown option " + flag);
+            }
+        }
+        vector<pair<string, function<void()>>> checks = {
+            {"deltas", checkDeltas},
+            {"recovery", [&] { checkRecovery(dir); }},
+            {"snapshot capacity", [&] { checkSnapshotCapacity(dir); }},
+            {"allocation", checkAllocation},
+            {"server", checkServer},
+            {"sharding", checkSharding},
+        };
+        for (const auto& [name, check] : checks) {
+            size_t before = check_failures;
+            check();
+            cout << (check_failures == before ? GREEN "ok   " : RED "FAIL ") << name << RESET << endl;
+        }
+    } catch (const exception& e) {
+        cerr << RED << "Error: " << e.what() << RESET << endl;
+        return 1;
+    }
+    return check_failures ? 1 : 0;
 }
 
+#else
+
 // --------------------------
 // Main Function
 // --------------------------
 
-int main() {
+int main(int argc, char** argv) {
     try {
+        optional<uint16_t> serve_port;
+        if (argc == 3 && string(argv[1]) == "--serve") {
+            unsigned long port = stoul(argv[2]);
+            if (port > 65535) throw runtime_error("Port out of range: " + string(argv[2]));
+            serve_port = uint16_t(port);
+        } else if (argc != 1) {
+            throw runtime_error(string("Usage: ") + argv[0] + " [--serve <port>]");
+        }
+
         // Initialize college
         College college("Chitkara University");
 
         // Read data from files
-        auto students = readStudentsFromFile("students.txt");
-        auto teachers = readTeachersFromFile("teachers.txt");
+        auto students = readStudentsFromFile("Students.txt", LoadMode::Parallel);
+        auto teachers = readTeachersFromFile("Teachers.txt", LoadMode::Parallel);
 
         // Add students and teachers to College
-        for (const auto& student : students) {
-            College.addStudent(student);
-        }
-        for (const auto& teacher : teachers) {
-            College.addTeacher(teacher);
-        }
+        college.addStudents(vector<shared_ptr<Student>>(students));
+        college.addTeachers(vector<shared_ptr<Teacher>>(teachers));
 
         // Add courses
         vector<shared_ptr<Course>> course_list = {
@@ -519,20 +7493,23 @@ int main() {
         for (const auto& course : course_list) {
             college.addCourse(course);
         }
+        college.buildPrerequisiteGraph();
 
-        // Assign courses to teachers
-        for (const auto& teacher : teachers) {
-            if (teacher->getSpecialization() == "Programming Paradigms") {
-                teacher->assignCourse("CS101");
-            } else if (teacher->getSpecialization() == "Network and Communication") {
-                teacher->assignCourse("CS201");
-            } else if (teacher->getSpecialization() == "Backend Development") {
-                teacher->assignCourse("CS301");
-            } else if (teacher->getSpecialization() == "Career Skills") {
-                teacher->assignCourse("PD101");
-            }
+        // Registrar changes dropped next to the rosters apply on top of them
+        if (ifstream("students.delta")) {
+            auto result = college.applyDelta(readStudentDelta("students.delta"));
+            cout << CYAN << "Applied students.delta: " << result.inserted << " added, " << result.updated
+                 << " updated, " << result.deleted << " removed" << RESET << endl;
+        }
+        if (ifstream("teachers.delta")) {
+            auto result = college.applyDelta(readTeacherDelta("teachers.delta"));
+            cout << CYAN << "Applied teachers.delta: " << result.inserted << " added, " << result.updated
+                 << " updated, " << result.deleted << " removed" << RESET << endl;
         }
 
+        // Assign courses to teachers
+        college.assignCourses(CourseAssignmentRules(DEFAULT_COURSE_RULES));
+
         // Enroll students in courses
         vector<pair<string, string>> enrollments = {
             {"S001", "CS101"}, {"S001", "CS201"}, {"S001", "PD101"},
@@ -547,28 +7524,35 @@ int main() {
             {"S010", "CS101"}, {"S010", "CS201"}, {"S010", "CS301"}
         };
         
-        for (const auto& [student_id, course_id] : enrollments) {
-            College.enrollStudentInCourse(student_id, course_id);
+        auto batch = college.enrollBatch(enrollments);
+        for (size_t i = 0; i < enrollments.size(); ++i) {
+            if (batch.statuses[i] != EnrollStatus::OK) {
+                cerr << RED << "Enrollment " << enrollments[i].first << " -> " << enrollments[i].second
+                     << " failed: " << enrollStatusToString(batch.statuses[i]) << RESET << endl;
+            }
         }
+        cout << GREEN << "Enrolled " << batch.enrolled << "/" << enrollments.size() << " requests in "
+             << duration<double, micro>(batch.elapsed).count() << "us ("
+             << fixed << setprecision(0) << batch.rowsPerSecond() << " rows/s)" << RESET << endl;
 
         // Demonstrate functional programming
         cout << BOLD << BLUE << "\nDepartment Statistics:" << RESET << endl;
-        auto dept_stats = College.getDepartmentStats();
+        auto dept_stats = college.getDepartmentStats();
         for (const auto& [dept, count] : dept_stats) {
             cout << CYAN << dept << RESET << ": " << count << " teachers" << endl;
         }
 
         // Demonstrate concurrent report generation
         cout << BOLD << BLUE << "\nGenerating reports concurrently..." << RESET << endl;
-        auto reports = College.generateAllStudentReports();
+        auto reports = college.generateAllStudentReports();
         cout << GREEN << "Generated " << reports.size() << " student reports" << RESET << endl;
 
         // Demonstrate reactive programming with WAM updates
-        College.simulateWAMUpdates();
+        college.simulateWAMUpdates();
 
         // Show updated top performers with color coding
         cout << BOLD << BLUE << "\nTop 3 Performers:" << RESET << endl;
-        auto top_performers = College.getTopPerformers(3);
+        auto top_performers = college.getTopPerformers(3);
         for (const auto& [name, wam] : top_performers) {
             string color = GREEN;
             if (wam < 70) color = YELLOW;
@@ -577,26 +7561,76 @@ int main() {
             cout << BOLD << name << RESET << ": " << color << fixed << setprecision(1) << wam << RESET << endl;
         }
 
+        // Course fill rates and score distributions
+        cout << BOLD << BLUE << "\nCourse Analytics:" << RESET << endl;
+        auto analytics = college.getAnalytics();
+        for (const auto& course : analytics.courses) {
+            cout << CYAN << symbols().name(course.course_id) << RESET << ": " << course.enrolled << "/"
+                 << course.capacity << " seats (" << fixed << setprecision(0) << course.fill_rate * 100
+                 << "% full), mean WAM " << setprecision(1) << course.wams.mean() << endl;
+        }
+
         // Demonstrate visitor pattern with color coding (DISPLAY ALL)
-        DisplayVisitor visitor;
         cout << BOLD << BLUE << "\nDisplaying ALL information with visitor pattern:" << RESET << endl;
 
+        // One reusable buffer, written out in large blocks
+        string display;
+        BufferedDisplayVisitor visitor(display, ReportFormat::Color);
+        auto flushDisplay = [&](bool force) {
+            if (force || display.size() >= 64 * 1024) {
+                cout.write(display.data(), display.size());
+                display.clear();
+            }
+        };
+        auto block = [&](const auto& entity) {
+            visitor.visit(entity);
+            display += '\n';
+            flushDisplay(false);
+        };
+        auto store = college.entities();
+
         // Display all students
-        cout << BOLD << MAGENTA << "\n=== ALL STUDENTS ===" << RESET << endl;
-        for (const auto& student : College.getStudents()) {
-            cout << visitor.visit(*student) << endl;
-        }
+        display += BOLD MAGENTA "\n=== ALL STUDENTS ===" RESET "\n";
+        for (const Student* student : store->getStudents()) block(*student);
 
         // Display all teachers
-        cout << BOLD << MAGENTA << "\n=== ALL TEACHERS ===" << RESET << endl;
-        for (const auto& teacher : College.getTeachers()) {
-            cout << visitor.visit(*teacher) << endl;
-        }
+        display += BOLD MAGENTA "\n=== ALL TEACHERS ===" RESET "\n";
+        for (const Teacher* teacher : store->getTeachers()) block(*teacher);
 
         // Display all courses
-        cout << BOLD << MAGENTA << "\n=== ALL COURSES ===" << RESET << endl;
-        for (const auto& course : College.getCourses()) {
-            cout << visitor.visit(*course) << endl;
+        display += BOLD MAGENTA "\n=== ALL COURSES ===" RESET "\n";
+        for (const Course* course : store->getCourses()) block(*course);
+        flushDisplay(true);
+        cout << flush;
+
+        // Unthrottled load against the grading pipeline
+        LoadConfig load;
+        load.producers = 2;
+        load.updates_per_producer = 50000;
+        load.student_distribution = LoadDistribution::ZIPF;
+        auto load_report = college.generateLoad(load);
+        auto us = [](nanoseconds ns) { return duration<double, micro>(ns).count(); };
+        cout << BOLD << BLUE << "\nLoad test:" << RESET << endl;
+        cout << GREEN << load_report.updates << " updates in " << fixed << setprecision(1)
+             << duration<double, milli>(load_report.elapsed).count() << "ms ("
+             << setprecision(0) << load_report.updatesPerSecond() << " updates/s)" << RESET << endl;
+        cout << CYAN << "updateWAM   p50 " << setprecision(2) << us(load_report.update_latency.p50)
+             << "us  p99 " << us(load_report.update_latency.p99) << "us  p999 " << us(load_report.update_latency.p999)
+             << "us" << RESET << endl;
+        cout << CYAN << "visibility  p50 " << us(load_report.visibility_latency.p50)
+             << "us  p99 " << us(load_report.visibility_latency.p99) << "us  p999 " << us(load_report.visibility_latency.p999)
+             << "us" << RESET << endl;
+
+        cout << BOLD << BLUE << "\nMetrics:" << RESET << endl;
+        cout << metrics().snapshot().toJson() << endl;
+
+        // Stay up for clients until interrupted
+        if (serve_port) {
+            RequestServer server(college, *serve_port);
+            signal(SIGINT, [](int) { stop_requested = 1; });
+            signal(SIGTERM, [](int) { stop_requested = 1; });
+            cout << GREEN << "Serving on 127.0.0.1:" << server.getPort() << " (Ctrl-C to stop)" << RESET << endl;
+            while (!stop_requested) this_thread::sleep_for(milliseconds(100));
         }
 
     } catch (const exception& e) {
@@ -606,3 +7640,5 @@ int main() {
 
     return 0;
 }
+
+#endif